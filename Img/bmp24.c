@@ -6,42 +6,80 @@
  */
 
 #include "bmp24.h"
+#include "bmp_io.h"
+#include "bmp_simd.h"
+#include "bmp_conv.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+
+/* Whole-image passes only split rows across threads above this pixel count */
+#define BMP24_PARALLEL_MIN (1 << 16)
 
 /* Memory Management */
 
+/* Allocates a BMP24_ALIGNMENT-aligned block */
+static void *bmp24_alignedAlloc(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, BMP24_ALIGNMENT);
+#else
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, BMP24_ALIGNMENT, size) != 0) return NULL;
+    return ptr;
+#endif
+}
+
+/* Frees a block returned by bmp24_alignedAlloc */
+static void bmp24_alignedFree(void *ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/* Returns the row stride in bytes for a given width */
+size_t bmp24_rowStride(int width) {
+    return ((size_t)width * sizeof(t_pixel) + BMP24_ALIGNMENT - 1) & ~(size_t)(BMP24_ALIGNMENT - 1);
+}
+
 /* Allocates memory for pixel data */
 t_pixel **bmp24_allocateDataPixels(int width, int height) {
-    t_pixel **pixels = (t_pixel **)malloc(height * sizeof(t_pixel *));
-    if (!pixels) return NULL;
+    if (width <= 0 || height <= 0) return NULL;
+
+    // Row pointer table first, then the pixel slab starting on the next aligned boundary
+    size_t tableSize = ((size_t)height * sizeof(t_pixel *) + BMP24_ALIGNMENT - 1) & ~(size_t)(BMP24_ALIGNMENT - 1);
+    size_t stride = bmp24_rowStride(width);
+    if (stride > (SIZE_MAX - tableSize) / (size_t)height) return NULL;
+    uint8_t *block = (uint8_t *)bmp24_alignedAlloc(tableSize + stride * height);
+    if (!block) return NULL;
 
+    t_pixel **pixels = (t_pixel **)block;
+    uint8_t *slab = block + tableSize;
     for (int i = 0; i < height; i++) {
-        pixels[i] = (t_pixel *)malloc(width * sizeof(t_pixel));
-        if (!pixels[i]) {
-            for (int j = 0; j < i; j++) free(pixels[j]);
-            free(pixels);
-            return NULL;
-        }
+        pixels[i] = (t_pixel *)(slab + (size_t)i * stride);
     }
     return pixels;
 }
 
 /* Frees memory allocated for pixel data */
 void bmp24_freeDataPixels(t_pixel **pixels, int height) {
+    (void)height;
     if (!pixels) return;
-    for (int i = 0; i < height; i++) free(pixels[i]);
-    free(pixels);
+    bmp24_alignedFree(pixels);
 }
 
 /* Allocates memory for a new BMP image */
 t_bmp24 *bmp24_allocate(int width, int height, int colorDepth) {
+    // The stride is kept in an int
+    if (width <= 0 || bmp24_rowStride(width) > INT_MAX) return NULL;
     t_bmp24 *img = (t_bmp24 *)malloc(sizeof(t_bmp24));
     if (!img) return NULL;
     img->width = width;
     img->height = height;
     img->colorDepth = colorDepth;
+    img->stride = (int)bmp24_rowStride(width);
     img->data = bmp24_allocateDataPixels(width, height);
     if (!img->data) {
         free(img);
@@ -57,6 +95,18 @@ void bmp24_free(t_bmp24 *img) {
     free(img);
 }
 
+/* Creates a deep copy of an image */
+t_bmp24 *bmp24_clone(const t_bmp24 *img) {
+    if (!img) return NULL;
+    t_bmp24 *copy = bmp24_allocate(img->width, img->height, img->colorDepth);
+    if (!copy) return NULL;
+    copy->header = img->header;
+    copy->header_info = img->header_info;
+    // Both slabs share the same stride, so the pixels are copied in one go
+    memcpy(copy->data[0], img->data[0], (size_t)img->stride * img->height);
+    return copy;
+}
+
 /* File I/O Operations */
 
 /* Prints basic information about the image */
@@ -68,6 +118,29 @@ void bmp24_printInfo(t_bmp24 *img) {
     printf("Color Depth: %d-bit\n", img->colorDepth);
 }
 
+/* Reads only the headers of a 24-bit BMP file */
+int bmp24_probe(const char *filename, t_bmp_probe *info) {
+    if (bmp_probe(filename, info) != 0) return -1;
+    if (info->colorDepth != 24) {
+        printf("Error: image is not 24-bit\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Checks the dimensions read from a header: -1 when the width is not positive,
+ * the height is 0 or INT_MIN (negative heights are top-down images), the slab
+ * stride does not fit int or the padded pixel array does not fit 32 bits
+ */
+static int bmp24_checkSize(int32_t width, int32_t height) {
+    if (width <= 0 || height == 0 || height == INT32_MIN) return -1;
+    if (bmp24_rowStride(width) > INT_MAX) return -1;
+    size_t rowSize = ((size_t)width * 3 + 3) & ~(size_t)3;
+    if (rowSize > UINT32_MAX / (uint32_t)abs(height)) return -1;
+    return 0;
+}
+
 /* Loads a 24-bit BMP image from file */
 t_bmp24 *bmp24_loadImage(const char *filename) {
     FILE *file = fopen(filename, "rb");
@@ -77,41 +150,126 @@ t_bmp24 *bmp24_loadImage(const char *filename) {
     }
 
     t_bmp_header header;
-    fread(&header, sizeof(t_bmp_header), 1, file);
-
     t_bmp_info info;
-    fread(&info, sizeof(t_bmp_info), 1, file);
+    if (fread(&header, sizeof(t_bmp_header), 1, file) != 1 ||
+        fread(&info, sizeof(t_bmp_info), 1, file) != 1) {
+        printf("Error: failed to read BMP header\n");
+        fclose(file);
+        return NULL;
+    }
 
     if (info.bits != 24) {
         printf("Error: image is not 24-bit\n");
         fclose(file);
         return NULL;
     }
+    if (bmp24_checkSize(info.width, info.height) != 0) {
+        printf("Error: invalid image size %dx%d\n", (int)info.width, (int)info.height);
+        fclose(file);
+        return NULL;
+    }
 
-    t_bmp24 *img = bmp24_allocate(info.width, info.height, info.bits);
+    int height = abs(info.height);
+    t_bmp24 *img = bmp24_allocate(info.width, height, info.bits);
     if (!img) {
+        printf("Error: memory allocation failed\n");
         fclose(file);
         return NULL;
     }
 
+    // Top-down files are stored bottom-up from here on, as bmp24_saveImage writes them
     img->header = header;
     img->header_info = info;
+    img->header_info.height = height;
 
     fseek(file, header.offset, SEEK_SET);
 
-    for (int i = img->height - 1; i >= 0; i--) {
-        for (int j = 0; j < img->width; j++) {
-            uint8_t bgr[3];
-            fread(bgr, sizeof(uint8_t), 3, file);
-            img->data[i][j].blue  = bgr[0];
-            img->data[i][j].green = bgr[1];
-            img->data[i][j].red   = bgr[2];
+    // Each padded file row fits in a slab row (stride >= rowSize), so rows are
+    // read straight into place and swizzled there
+    size_t rowSize = ((size_t)img->width * 3 + 3) & ~(size_t)3;
+    for (int r = 0; r < height; r++) {
+        uint8_t *row = (uint8_t *)img->data[info.height < 0 ? r : height - 1 - r];
+        if (fread(row, 1, rowSize, file) != rowSize) {
+            printf("Error: failed to read image data\n");
+            bmp24_free(img);
+            fclose(file);
+            return NULL;
         }
+        bmp_swapRedBlue(row, row, img->width);
     }
     fclose(file);
     return img;
 }
 
+/* Loads a rectangular region of a 24-bit BMP image */
+t_bmp24 *bmp24_loadRegion(const char *filename, int x, int y, int w, int h) {
+    int fd = bmp_openRead(filename);
+    if (fd < 0) {
+        printf("Error: cannot open file %s\n", filename);
+        return NULL;
+    }
+
+    t_bmp_header header;
+    t_bmp_info info;
+    if (bmp_readAt(fd, &header, sizeof(t_bmp_header), 0) != 0 ||
+        bmp_readAt(fd, &info, sizeof(t_bmp_info), sizeof(t_bmp_header)) != 0) {
+        printf("Error: failed to read BMP header\n");
+        bmp_closeRead(fd);
+        return NULL;
+    }
+
+    if (info.bits != 24) {
+        printf("Error: image is not 24-bit\n");
+        bmp_closeRead(fd);
+        return NULL;
+    }
+    if (bmp24_checkSize(info.width, info.height) != 0) {
+        printf("Error: invalid image size %dx%d\n", (int)info.width, (int)info.height);
+        bmp_closeRead(fd);
+        return NULL;
+    }
+    int height = abs(info.height);
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || w > info.width - x || h > height - y) {
+        printf("Error: region %dx%d at (%d, %d) is outside the %dx%d image\n", w, h, x, y, info.width, height);
+        bmp_closeRead(fd);
+        return NULL;
+    }
+
+    t_bmp24 *img = bmp24_allocate(w, h, 24);
+    if (!img) {
+        bmp_closeRead(fd);
+        return NULL;
+    }
+
+    // Only the w * 3 bytes of each needed row are read; file rows are bottom-up unless height < 0
+    size_t srcRowSize = ((size_t)info.width * 3 + 3) & ~(size_t)3;
+    for (int i = 0; i < h; i++) {
+        int srcRow = (info.height < 0) ? y + i : height - 1 - (y + i);
+        unsigned long long offset = header.offset + (unsigned long long)srcRow * srcRowSize + (size_t)x * 3;
+        uint8_t *row = (uint8_t *)img->data[i];
+        if (bmp_readAt(fd, row, (size_t)w * 3, offset) != 0) {
+            printf("Error: failed to read image data\n");
+            bmp24_free(img);
+            bmp_closeRead(fd);
+            return NULL;
+        }
+        bmp_swapRedBlue(row, row, w);
+    }
+    bmp_closeRead(fd);
+
+    // Headers describing the crop as a standalone bottom-up image
+    size_t rowSize = ((size_t)w * 3 + 3) & ~(size_t)3;
+    img->header = header;
+    img->header_info = info;
+    img->header.offset = sizeof(t_bmp_header) + sizeof(t_bmp_info);
+    img->header.size = (uint32_t)(img->header.offset + rowSize * h);
+    img->header_info.size = sizeof(t_bmp_info);
+    img->header_info.width = w;
+    img->header_info.height = h;
+    img->header_info.imagesize = (uint32_t)(rowSize * h);
+    return img;
+}
+
 /* Saves a 24-bit BMP image to file */
 void bmp24_saveImage(t_bmp24 *img, const char *filename) {
     if (!img) return;
@@ -121,28 +279,25 @@ void bmp24_saveImage(t_bmp24 *img, const char *filename) {
         return;
     }
 
+    // Staging row in file order, the padding bytes stay zero
+    size_t rowSize = ((size_t)img->width * 3 + 3) & ~(size_t)3;
+    uint8_t *staging = (uint8_t *)calloc(rowSize, 1);
+    if (!staging) {
+        printf("Error: memory allocation for row buffer failed\n");
+        fclose(file);
+        return;
+    }
+
     fwrite(&img->header, sizeof(t_bmp_header), 1, file);
     fwrite(&img->header_info, sizeof(t_bmp_info), 1, file);
 
     fseek(file, img->header.offset, SEEK_SET); // Seek to the pixel data start
 
-    int row_padding = (4 - (img->width * 3) % 4) % 4;
-    uint8_t padding_data[3] = {0, 0, 0}; // Padding bytes (can be anything, usually 0)
-
     for (int i = img->height - 1; i >= 0; i--) {
-        for (int j = 0; j < img->width; j++) {
-            uint8_t bgr[3] = {
-                img->data[i][j].blue,
-                img->data[i][j].green,
-                img->data[i][j].red
-            };
-            fwrite(bgr, sizeof(uint8_t), 3, file);
-        }
-        // Write padding bytes at the end of each row if needed
-        if (row_padding > 0) {
-            fwrite(padding_data, sizeof(uint8_t), row_padding, file);
-        }
+        bmp_swapRedBlue(staging, (const uint8_t *)img->data[i], img->width);
+        fwrite(staging, 1, rowSize, file);
     }
+    free(staging);
     fclose(file);
     printf("Saved image to: %s\n", filename);
 }
@@ -151,12 +306,9 @@ void bmp24_saveImage(t_bmp24 *img, const char *filename) {
 
 /* Creates a negative version of the image */
 void bmp24_negative(t_bmp24 *img) {
+    // Same operation on every channel, so each row is processed as plain bytes
     for (int i = 0; i < img->height; i++) {
-        for (int j = 0; j < img->width; j++) {
-            img->data[i][j].red   = 255 - img->data[i][j].red;
-            img->data[i][j].green = 255 - img->data[i][j].green;
-            img->data[i][j].blue  = 255 - img->data[i][j].blue;
-        }
+        bmp_negativeBytes((uint8_t *)bmp24_row(img, i), (size_t)img->width * 3);
     }
 }
 
@@ -170,20 +322,273 @@ void bmp24_grayscale(t_bmp24 *img) {
     }
 }
 
+/* Converts the image to a true 8-bit grayscale image using luma weights */
+t_bmp8 *bmp24_toBmp8(const t_bmp24 *img, int standard) {
+    if (!img) return NULL;
+
+    // Weights in 1/32768 for the red, green and blue bytes of t_pixel, each triple sums to 32768
+    int cr = 9798, cg = 19235, cb = 3735;
+    if (standard == BMP24_LUMA_BT709) {
+        cr = 6966;
+        cg = 23436;
+        cb = 2366;
+    }
+
+    t_bmp8 *gray = (t_bmp8 *)malloc(sizeof(t_bmp8));
+    if (!gray) {
+        printf("Error: memory allocation failed\n");
+        return NULL;
+    }
+    unsigned int rowSize = ((unsigned int)img->width + 3) & ~3u;
+    gray->width = img->width;
+    gray->height = img->height;
+    gray->colorDepth = 8;
+    gray->dataSize = rowSize * img->height;
+    gray->mapping.base = NULL;
+    gray->mapping.size = 0;
+    gray->data = (unsigned char *)calloc(gray->dataSize, 1);
+    if (!gray->data) {
+        printf("Error: memory allocation failed\n");
+        free(gray);
+        return NULL;
+    }
+
+    // BMP headers for an uncompressed 8-bit image with a 256-entry palette
+    t_bmp_header header = img->header;
+    t_bmp_info info = img->header_info;
+    header.type = 0x4D42;
+    header.offset = sizeof(t_bmp_header) + sizeof(t_bmp_info) + 1024;
+    header.size = header.offset + gray->dataSize;
+    info.size = sizeof(t_bmp_info);
+    info.width = img->width;
+    info.height = img->height;
+    info.planes = 1;
+    info.bits = 8;
+    info.compression = 0;
+    info.imagesize = gray->dataSize;
+    info.ncolors = 256;
+    info.importantcolors = 0;
+    memcpy(gray->header, &header, sizeof(t_bmp_header));
+    memcpy(gray->header + sizeof(t_bmp_header), &info, sizeof(t_bmp_info));
+
+    for (int i = 0; i < 256; i++) {
+        gray->colorTable[4 * i] = gray->colorTable[4 * i + 1] = gray->colorTable[4 * i + 2] = (unsigned char)i;
+        gray->colorTable[4 * i + 3] = 0;
+    }
+
+    // 8-bit data is kept in file order, bottom row first
+    for (int i = 0; i < img->height; i++) {
+        bmp_lumaBytes(gray->data + (size_t)(img->height - 1 - i) * rowSize,
+                      (const uint8_t *)bmp24_row(img, i), img->width, cr, cg, cb);
+    }
+    return gray;
+}
+
+/* Equalizes the luma histogram, leaving the chroma untouched */
+void bmp24_equalize(t_bmp24 *img) {
+    if (!img || !img->data) return;
+
+    unsigned int hist[256] = {0};
+    int height = img->height;
+
+    // Pass 1: RGB -> YCbCr in place, counting luma on the way
+    #pragma omp parallel if ((long)img->width * height >= BMP24_PARALLEL_MIN)
+    {
+        unsigned int local[256] = {0};
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < height; i++) {
+            bmp_toYCbCr((uint8_t *)bmp24_row(img, i), img->width, local);
+        }
+
+        #pragma omp critical
+        for (int i = 0; i < 256; i++) {
+            hist[i] += local[i];
+        }
+    }
+
+    uint8_t lut[256];
+    unsigned int *cdf = bmp8_computeCDF(hist, (unsigned int)img->width * height);
+    for (int i = 0; i < 256; i++) {
+        lut[i] = cdf ? (uint8_t)cdf[i] : (uint8_t)i;
+    }
+    free(cdf);
+
+    // Pass 2: equalized luma, back to RGB
+    #pragma omp parallel for schedule(static) if ((long)img->width * height >= BMP24_PARALLEL_MIN)
+    for (int i = 0; i < height; i++) {
+        bmp_fromYCbCr((uint8_t *)bmp24_row(img, i), img->width, lut);
+    }
+}
+
 /* Adjusts image brightness */
 void bmp24_brightness(t_bmp24 *img, int value) {
     for (int i = 0; i < img->height; i++) {
+        bmp_brightnessBytes((uint8_t *)bmp24_row(img, i), (size_t)img->width * 3, value);
+    }
+}
+
+/* Fused Point Operations */
+
+/* Composes the same 256-entry map onto all three channel tables */
+static void bmp24_lutMap(t_bmp24_lut *lut, const uint8_t *map) {
+    for (int i = 0; i < 256; i++) {
+        lut->red[i]   = map[lut->red[i]];
+        lut->green[i] = map[lut->green[i]];
+        lut->blue[i]  = map[lut->blue[i]];
+    }
+}
+
+/* Resets a lookup table to the identity */
+void bmp24_lutInit(t_bmp24_lut *lut) {
+    for (int i = 0; i < 256; i++) {
+        lut->red[i] = lut->green[i] = lut->blue[i] = (uint8_t)i;
+    }
+}
+
+/* Composes a negative onto a lookup table */
+void bmp24_lutNegative(t_bmp24_lut *lut) {
+    uint8_t map[256];
+    for (int i = 0; i < 256; i++) map[i] = (uint8_t)(255 - i);
+    bmp24_lutMap(lut, map);
+}
+
+/* Composes a brightness adjustment onto a lookup table */
+void bmp24_lutBrightness(t_bmp24_lut *lut, int value) {
+    uint8_t map[256];
+    for (int i = 0; i < 256; i++) {
+        int v = i + value;
+        map[i] = (v > 255) ? 255 : (v < 0 ? 0 : v);
+    }
+    bmp24_lutMap(lut, map);
+}
+
+/* Composes a levels adjustment onto a lookup table */
+void bmp24_lutLevels(t_bmp24_lut *lut, int inLow, int inHigh, int outLow, int outHigh) {
+    uint8_t map[256];
+    for (int i = 0; i < 256; i++) {
+        int v;
+        if (i <= inLow) v = outLow;
+        else if (i >= inHigh) v = outHigh;
+        else v = outLow + (int)lroundf((float)(i - inLow) * (outHigh - outLow) / (inHigh - inLow));
+        map[i] = (v > 255) ? 255 : (v < 0 ? 0 : v);
+    }
+    bmp24_lutMap(lut, map);
+}
+
+/* Composes a gamma correction onto a lookup table */
+void bmp24_lutGamma(t_bmp24_lut *lut, float gamma) {
+    if (gamma <= 0) return;
+    uint8_t map[256];
+    for (int i = 0; i < 256; i++) {
+        map[i] = (uint8_t)lroundf(255.0f * powf(i / 255.0f, 1.0f / gamma));
+    }
+    bmp24_lutMap(lut, map);
+}
+
+/* Composes arbitrary per-channel curves onto a lookup table */
+void bmp24_lutCurve(t_bmp24_lut *lut, const uint8_t *red, const uint8_t *green, const uint8_t *blue) {
+    for (int i = 0; i < 256; i++) {
+        if (red)   lut->red[i]   = red[lut->red[i]];
+        if (green) lut->green[i] = green[lut->green[i]];
+        if (blue)  lut->blue[i]  = blue[lut->blue[i]];
+    }
+}
+
+/* Applies a lookup table to every pixel in a single pass */
+void bmp24_applyLUT(t_bmp24 *img, const t_bmp24_lut *lut) {
+    for (int i = 0; i < img->height; i++) {
+        t_pixel *row = bmp24_row(img, i);
         for (int j = 0; j < img->width; j++) {
-            int r = img->data[i][j].red + value;
-            int g = img->data[i][j].green + value;
-            int b = img->data[i][j].blue + value;
-            img->data[i][j].red   = (r > 255) ? 255 : (r < 0 ? 0 : r);
-            img->data[i][j].green = (g > 255) ? 255 : (g < 0 ? 0 : g);
-            img->data[i][j].blue  = (b > 255) ? 255 : (b < 0 ? 0 : b);
+            row[j].red   = lut->red[row[j].red];
+            row[j].green = lut->green[row[j].green];
+            row[j].blue  = lut->blue[row[j].blue];
         }
     }
 }
 
+/* In-Place File Editing */
+
+/*
+ * Maps a 24-bit BMP for editing. With dst NULL src itself is edited,
+ * otherwise dst is created as a copy of src first.
+ * Returns the start of the pixel array, NULL on failure.
+ */
+static uint8_t *bmp24_mapForEdit(const char *src, const char *dst, t_bmp_mapping *map, t_bmp_info *info) {
+    int result = dst ? bmp_mapCopy(src, dst, map) : bmp_mapFile(src, BMP_MAP_SHARED, map);
+    if (result != 0) return NULL;
+
+    t_bmp_header header;
+    if (map->size < sizeof(t_bmp_header) + sizeof(t_bmp_info)) {
+        printf("Error: file %s is too small to be a BMP\n", src);
+        bmp_unmapFile(map);
+        bmp_removeCopy(src, dst);
+        return NULL;
+    }
+    memcpy(&header, map->base, sizeof(t_bmp_header));
+    memcpy(info, map->base + sizeof(t_bmp_header), sizeof(t_bmp_info));
+
+    if (info->bits != 24) {
+        printf("Error: image is not 24-bit\n");
+        bmp_unmapFile(map);
+        bmp_removeCopy(src, dst);
+        return NULL;
+    }
+    // Sizes come from the file: reject anything whose pixel array size does not fit size_t
+    if (info->width <= 0 || info->height == 0 || info->height == INT_MIN ||
+        (size_t)info->width > (SIZE_MAX - 3) / 3) {
+        printf("Error: invalid image size in %s\n", src);
+        bmp_unmapFile(map);
+        bmp_removeCopy(src, dst);
+        return NULL;
+    }
+    size_t rowSize = ((size_t)info->width * 3 + 3) & ~(size_t)3;
+    size_t rows = (size_t)abs(info->height);
+    if (rowSize > (SIZE_MAX - header.offset) / rows ||
+        (size_t)header.offset + rowSize * rows > map->size) {
+        printf("Error: image data of %s is truncated\n", src);
+        bmp_unmapFile(map);
+        bmp_removeCopy(src, dst);
+        return NULL;
+    }
+    return map->base + header.offset;
+}
+
+/* Inverts every pixel of a BMP file in place (or of a copy of it) */
+int bmp24_negativeFile(const char *src, const char *dst) {
+    t_bmp_mapping map;
+    t_bmp_info info;
+    uint8_t *pixels = bmp24_mapForEdit(src, dst, &map, &info);
+    if (!pixels) return -1;
+
+    // Channel order does not matter here, so the BGR file rows are edited as plain bytes
+    size_t rowSize = ((size_t)info.width * 3 + 3) & ~(size_t)3;
+    size_t rowBytes = (size_t)info.width * 3;
+    for (int i = 0; i < abs(info.height); i++) {
+        bmp_negativeBytes(pixels + i * rowSize, rowBytes);
+    }
+    bmp_unmapFile(&map);
+    printf("Saved image to: %s\n", dst ? dst : src);
+    return 0;
+}
+
+/* Adjusts the brightness of a BMP file in place (or of a copy of it) */
+int bmp24_brightnessFile(const char *src, const char *dst, int value) {
+    t_bmp_mapping map;
+    t_bmp_info info;
+    uint8_t *pixels = bmp24_mapForEdit(src, dst, &map, &info);
+    if (!pixels) return -1;
+
+    size_t rowSize = ((size_t)info.width * 3 + 3) & ~(size_t)3;
+    size_t rowBytes = (size_t)info.width * 3;
+    for (int i = 0; i < abs(info.height); i++) {
+        bmp_brightnessBytes(pixels + i * rowSize, rowBytes, value);
+    }
+    bmp_unmapFile(&map);
+    printf("Saved image to: %s\n", dst ? dst : src);
+    return 0;
+}
+
 /* Advanced Image Processing */
 
 // Convolution and filtering operations
@@ -213,18 +618,58 @@ t_pixel bmp24_convolution(t_bmp24 *img, int x, int y, float **kernel, int kernel
     return result;
 }
 
+/* Filters every pixel in place; taps outside the image are skipped */
+static void bmp24_filterKernel(t_bmp24 *img, const t_bmp_kernel *kernel) {
+    if (!img->data) return;
+
+    // Kernel rows run top-down over the image rows
+    bmp_convPlane(kernel, (uint8_t *)img->data[0], img->stride, img->width, img->height, 3,
+                  0, img->height, 0, img->width);
+}
+
 void bmp24_applyFilter(t_bmp24 *img, float **kernel, int kernelSize) {
-    t_pixel **copy = bmp24_allocateDataPixels(img->width, img->height);
-    for (int i = 0; i < img->height; i++) {
-        for (int j = 0; j < img->width; j++) {
-            copy[i][j] = bmp24_convolution(img, i, j, kernel, kernelSize);
-        }
-    }
+    t_bmp_kernel prepared;
+    if (bmp_kernelPrepare(&prepared, kernel, kernelSize) != 0) return;
+    bmp24_filterKernel(img, &prepared);
+    bmp_kernelRelease(&prepared);
+}
 
-    for (int i = 0; i < img->height; i++) {
-        for (int j = 0; j < img->width; j++) {
-            img->data[i][j] = copy[i][j];
-        }
+void bmp24_applyFilterBorder(t_bmp24 *img, float **kernel, int kernelSize, int mode, unsigned char value) {
+    if (!img || !img->data) return;
+    if (mode < BMP_BORDER_CONSTANT || mode > BMP_BORDER_WRAP) {
+        printf("Error: Unknown border mode %d.\n", mode);
+        return;
     }
-    bmp24_freeDataPixels(copy, img->height);
+
+    t_bmp_kernel prepared;
+    if (bmp_kernelPrepare(&prepared, kernel, kernelSize) != 0) return;
+    bmp_convPlaneBorder(&prepared, (uint8_t *)img->data[0], img->stride, img->width, img->height, 3, mode, value);
+    bmp_kernelRelease(&prepared);
+}
+
+void bmp24_applySeparableFilter(t_bmp24 *img, const float *rowTaps, const float *colTaps, int kernelSize) {
+    t_bmp_kernel prepared;
+    if (bmp_kernelSeparable(&prepared, rowTaps, colTaps, kernelSize) != 0) return;
+    bmp24_filterKernel(img, &prepared);
+    bmp_kernelRelease(&prepared);
+}
+
+void bmp24_boxFilter(t_bmp24 *img, int radius) {
+    if (!img || !img->data) return;
+
+    bmp_boxFilterPlane((uint8_t *)img->data[0], (size_t)img->stride, img->width, img->height, 3, radius);
+}
+
+void bmp24_gaussianBlur(t_bmp24 *img, float sigma) {
+    if (!img || !img->data) return;
+
+    bmp_gaussianPlane((uint8_t *)img->data[0], (size_t)img->stride, img->width, img->height, 3, sigma);
+}
+
+/* Local Statistics */
+
+t_bmp_integral *bmp24_integral(const t_bmp24 *img) {
+    if (!img || !img->data) return NULL;
+
+    return bmp_integralCreate((const uint8_t *)img->data[0], img->stride, img->width, img->height, 3);
 }
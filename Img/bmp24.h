@@ -12,9 +12,20 @@
 
 #include <stdint.h>
 #include <stdio.h>  // For FILE*
+#include "bmp_io.h"
+#include "bmp8.h"
+
+/* Luma weightings for grayscale conversion */
+#define BMP24_LUMA_BT601 0  ///< Y = 0.299 R + 0.587 G + 0.114 B
+#define BMP24_LUMA_BT709 1  ///< Y = 0.2126 R + 0.7152 G + 0.0722 B
 
 #pragma pack(1) // Disable padding
 
+/**
+ * Alignment in bytes of the pixel slab and of every row inside it
+ */
+#define BMP24_ALIGNMENT 64
+
 /**
  * Structure representing a single RGB pixel
  */
@@ -61,13 +72,32 @@ typedef struct {
     int width;               ///< Width
     int height;              ///< Height
     int colorDepth;          ///< Color depth
-    t_pixel **data;          ///< Pixel data
+    int stride;              ///< Row stride in bytes (multiple of BMP24_ALIGNMENT)
+    t_pixel **data;          ///< Row pointers into the contiguous pixel slab
 } t_bmp24;
 
 #pragma pack() // Re-enable padding
 
+/**
+ * Per-channel lookup tables for a chain of point operations
+ */
+typedef struct {
+    uint8_t red[256];    ///< Output red value for each input red value
+    uint8_t green[256];  ///< Output green value for each input green value
+    uint8_t blue[256];   ///< Output blue value for each input blue value
+} t_bmp24_lut;
+
+/**
+ * Returns the row stride in bytes used for an image of the given width
+ * Image width
+ * Width * 3 rounded up to BMP24_ALIGNMENT
+ */
+size_t bmp24_rowStride(int width);
+
 /**
  * Allocates memory for pixel data
+ * The row pointer table and all rows share a single BMP24_ALIGNMENT-aligned
+ * allocation, rows are bmp24_rowStride(width) bytes apart
  * Image width
  * Image height
  * 2D array of pixels
@@ -77,10 +107,19 @@ t_pixel **bmp24_allocateDataPixels(int width, int height);
 /**
  * Frees memory allocated for pixel data
  * 2D array of pixels
- * Image height
+ * Image height (unused, kept for compatibility)
  */
 void bmp24_freeDataPixels(t_pixel **pixels, int height);
 
+/**
+ * Returns a pointer to the first pixel of a row
+ * Pointer to image structure
+ * Row index (0 is the top row)
+ */
+static inline t_pixel *bmp24_row(const t_bmp24 *img, int y) {
+    return (t_pixel *)((uint8_t *)img->data[0] + (size_t)y * img->stride);
+}
+
 /**
  * Allocates memory for a new BMP image
  * Image width
@@ -96,6 +135,13 @@ t_bmp24 *bmp24_allocate(int width, int height, int colorDepth);
  */
 void bmp24_free(t_bmp24 *img);
 
+/**
+ * Creates a deep copy of an image (headers and pixels)
+ * Pointer to image structure
+ * Pointer to new image structure, NULL if allocation fails
+ */
+t_bmp24 *bmp24_clone(const t_bmp24 *img);
+
 /**
  * Loads a 24-bit BMP image from file
  * Path to the BMP file
@@ -103,6 +149,18 @@ void bmp24_free(t_bmp24 *img);
  */
 t_bmp24 *bmp24_loadImage(const char *filename);
 
+/**
+ * Loads a rectangular region of a 24-bit BMP image
+ * Only the bytes of the requested rows are read, with positioned reads
+ * Path to the BMP file
+ * Left column of the region
+ * Top row of the region (0 is the top of the image)
+ * Region width
+ * Region height
+ * Pointer to a w x h image structure, NULL if loading fails
+ */
+t_bmp24 *bmp24_loadRegion(const char *filename, int x, int y, int w, int h);
+
 /**
  * Saves a 24-bit BMP image to file
  * Pointer to image structure
@@ -116,6 +174,14 @@ void bmp24_saveImage(t_bmp24 *img, const char *filename);
  */
 void bmp24_printInfo(t_bmp24 *img);
 
+/**
+ * Reads only the headers of a 24-bit BMP file
+ * Path to the BMP file
+ * Structure filled with dimensions, depth, offset and compression
+ * 0 on success, -1 if the file cannot be read or is not 24-bit
+ */
+int bmp24_probe(const char *filename, t_bmp_probe *info);
+
 /**
  * Creates a negative version of the image
  * Pointer to image structure
@@ -128,6 +194,22 @@ void bmp24_negative(t_bmp24 *img);
  */
 void bmp24_grayscale(t_bmp24 *img);
 
+/**
+ * Converts the image to a true 8-bit grayscale image using luma weights
+ * The result has a grayscale color table and one byte per pixel
+ * Pointer to image structure
+ * BMP24_LUMA_BT601 or BMP24_LUMA_BT709
+ * Pointer to new 8-bit image structure, NULL if allocation fails
+ */
+t_bmp8 *bmp24_toBmp8(const t_bmp24 *img, int standard);
+
+/**
+ * Equalizes the histogram of the luma (full-range BT.601 YCbCr) and keeps the chroma
+ * Two passes: to YCbCr with the luma histogram, then equalized luma back to RGB
+ * Pointer to image structure
+ */
+void bmp24_equalize(t_bmp24 *img);
+
 /**
  * Adjusts image brightness
  * Pointer to image structure
@@ -135,6 +217,74 @@ void bmp24_grayscale(t_bmp24 *img);
  */
 void bmp24_brightness(t_bmp24 *img, int value);
 
+/**
+ * Creates a negative version of a BMP file without loading it
+ * The pixels are edited through a shared memory mapping
+ * Path to the source file
+ * Path to the output file (created as a copy of src), NULL to edit src itself
+ * 0 on success, -1 on failure
+ */
+int bmp24_negativeFile(const char *src, const char *dst);
+
+/**
+ * Adjusts the brightness of a BMP file without loading it
+ * The pixels are edited through a shared memory mapping
+ * Path to the source file
+ * Path to the output file (created as a copy of src), NULL to edit src itself
+ * Brightness adjustment value (-255 to 255)
+ * 0 on success, -1 on failure
+ */
+int bmp24_brightnessFile(const char *src, const char *dst, int value);
+
+/**
+ * Resets a lookup table to the identity
+ * Pointer to the table
+ */
+void bmp24_lutInit(t_bmp24_lut *lut);
+
+/**
+ * Composes a negative onto a lookup table
+ * Pointer to the table
+ */
+void bmp24_lutNegative(t_bmp24_lut *lut);
+
+/**
+ * Composes a brightness adjustment onto a lookup table
+ * Pointer to the table
+ * Brightness adjustment value (-255 to 255)
+ */
+void bmp24_lutBrightness(t_bmp24_lut *lut, int value);
+
+/**
+ * Composes a levels adjustment onto a lookup table
+ * Values up to inLow map to outLow, values from inHigh map to outHigh, linear in between
+ * Pointer to the table
+ * Input black point, input white point (0 to 255)
+ * Output black point, output white point (0 to 255)
+ */
+void bmp24_lutLevels(t_bmp24_lut *lut, int inLow, int inHigh, int outLow, int outHigh);
+
+/**
+ * Composes a gamma correction onto a lookup table: out = 255 * (in / 255)^(1 / gamma)
+ * Pointer to the table
+ * Gamma (> 1 brightens midtones, < 1 darkens them)
+ */
+void bmp24_lutGamma(t_bmp24_lut *lut, float gamma);
+
+/**
+ * Composes arbitrary per-channel curves onto a lookup table
+ * Pointer to the table
+ * 256-entry curves for red, green and blue, NULL leaves that channel unchanged
+ */
+void bmp24_lutCurve(t_bmp24_lut *lut, const uint8_t *red, const uint8_t *green, const uint8_t *blue);
+
+/**
+ * Applies a lookup table to every pixel in a single pass
+ * Pointer to image structure
+ * Pointer to the table
+ */
+void bmp24_applyLUT(t_bmp24 *img, const t_bmp24_lut *lut);
+
 /**
  * Applies convolution to a single pixel
  * Pointer to image structure
@@ -148,10 +298,58 @@ t_pixel bmp24_convolution(t_bmp24 *img, int x, int y, float **kernel, int kernel
 
 /**
  * Applies a convolution filter to the entire image
+ * Non-separable kernels of 17 taps and more may go through the FFT (see
+ * bmp_fftConvPlane), which can change a pixel by one level
  * Pointer to image structure
  * 2D filter kernel
  * Size of the kernel (must be odd)
  */
 void bmp24_applyFilter(t_bmp24 *img, float **kernel, int kernelSize);
 
+/**
+ * Applies a convolution filter with an explicit border mode
+ * Every row is copied once into a padded buffer, so the filter itself runs
+ * without bounds checks; BMP_BORDER_CONSTANT with value 0 matches bmp24_applyFilter
+ * (up to one level for the large kernels that bmp24_applyFilter runs through the FFT)
+ * Pointer to image structure
+ * 2D filter kernel, size of the kernel (must be odd)
+ * BMP_BORDER_CONSTANT, BMP_BORDER_CLAMP, BMP_BORDER_MIRROR or BMP_BORDER_WRAP
+ * Value of every channel outside the image for BMP_BORDER_CONSTANT
+ */
+void bmp24_applyFilterBorder(t_bmp24 *img, float **kernel, int kernelSize, int mode, unsigned char value);
+
+/**
+ * Applies a separable filter given by its 1-D factors (2 * kernelSize taps per pixel)
+ * bmp24_applyFilter detects rank-1 kernels by itself; this skips the detection
+ * Pointer to image structure
+ * Horizontal factor, vertical factor (top to bottom)
+ * Size of both factors (must be odd)
+ */
+void bmp24_applySeparableFilter(t_bmp24 *img, const float *rowTaps, const float *colTaps, int kernelSize);
+
+/**
+ * Box (mean) blur with running sums, so the cost per pixel does not depend on the radius
+ * Near the border only the pixels inside the image are averaged
+ * Pointer to image structure
+ * Radius of the (2 * radius + 1)^2 window (the image is left as is when the
+ * radius, once limited to the image size, is above BMP_BOX_MAX_RADIUS)
+ */
+void bmp24_boxFilter(t_bmp24 *img, int radius);
+
+/**
+ * Gaussian blur by a recursive (IIR) filter, so the cost per pixel does not depend on sigma
+ * Outside the image the edge pixel is repeated; results are within two levels of an exact Gaussian
+ * Scratch per thread is 64 doubles per image row plus one row of doubles, not a copy of the image
+ * Pointer to image structure
+ * Standard deviation in pixels (below BMP_GAUSS_IIR_MIN_SIGMA a short direct kernel is used)
+ */
+void bmp24_gaussianBlur(t_bmp24 *img, float sigma);
+
+/**
+ * Builds the summed-area tables of the three channels (channel 0 red, 1 green, 2 blue)
+ * Pointer to image structure
+ * Pointer to new tables (free with bmp_integralFree), NULL if allocation fails
+ */
+t_bmp_integral *bmp24_integral(const t_bmp24 *img);
+
 #endif // BMP24_H
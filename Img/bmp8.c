@@ -5,10 +5,51 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <limits.h>
 #include "bmp8.h"
+#include "bmp_simd.h"
+#include "bmp_conv.h"
+#include "bmp_integral.h"
+
+/*
+ * Histograms are counted into 4 interleaved banks so runs of equal pixels do
+ * not serialize on one counter; only the width pixels of a row are counted,
+ * never its padding.
+ */
+#define BMP8_HIST_BANKS 4
+#define BMP8_HIST_PARALLEL_MIN (1u << 16)
+#define BMP8_LOAD_CHUNK (1u << 16)
+
+/* Adds the pixels of one row to banked counters */
+static void bmp8_countRow(unsigned int banks[BMP8_HIST_BANKS][256], const unsigned char *row, unsigned int width) {
+    unsigned int x = 0;
+    for (; x + BMP8_HIST_BANKS <= width; x += BMP8_HIST_BANKS) {
+        banks[0][row[x]]++;
+        banks[1][row[x + 1]]++;
+        banks[2][row[x + 2]]++;
+        banks[3][row[x + 3]]++;
+    }
+    for (; x < width; x++) {
+        banks[0][row[x]]++;
+    }
+}
 
 /* File I/O Operations */
-t_bmp8* bmp8_loadImage(const char *filename) {
+
+/*
+ * Padded pixel array size of a width x height image read from a header, -1 when
+ * a dimension is 0 or above INT_MAX (filters work in int) or the size does not
+ * fit the 32-bit dataSize field
+ */
+static int bmp8_checkSize(unsigned int width, unsigned int height, unsigned int *dataSize) {
+    if (width == 0 || height == 0 || width > INT_MAX || height > INT_MAX) return -1;
+    size_t rowSize = ((size_t)width + 3) & ~(size_t)3;
+    if (rowSize > UINT_MAX / height) return -1;
+    *dataSize = (unsigned int)(rowSize * height);
+    return 0;
+}
+
+static t_bmp8* bmp8_load(const char *filename, t_bmp8_stats *stats) {
     FILE *file = fopen(filename, "rb");
     if (!file) {
         printf("Error: Unable to open file %s\n", filename);
@@ -36,8 +77,13 @@ t_bmp8* bmp8_loadImage(const char *filename) {
     }
 
     // Calculate data size (each row is padded to 4-byte boundary)
+    unsigned int dataSize;
+    if (bmp8_checkSize(width, height, &dataSize) != 0) {
+        printf("Error: Invalid image size %ux%u.\n", width, height);
+        fclose(file);
+        return NULL;
+    }
     unsigned int rowSize = (width + 3) & ~3;
-    unsigned int dataSize = rowSize * height;
 
     // Allocate memory for the image structure
     t_bmp8 *image = (t_bmp8*)malloc(sizeof(t_bmp8));
@@ -52,6 +98,8 @@ t_bmp8* bmp8_loadImage(const char *filename) {
     image->height = height;
     image->colorDepth = colorDepth;
     image->dataSize = dataSize;
+    image->mapping.base = NULL;
+    image->mapping.size = 0;
     
     // Copy header
     memcpy(image->header, header, 54);
@@ -59,7 +107,6 @@ t_bmp8* bmp8_loadImage(const char *filename) {
     // Read color table
     if (fread(image->colorTable, sizeof(unsigned char), 1024, file) != 1024) {
         printf("Error: Failed to read color table.\n");
-        free(image->data);
         free(image);
         fclose(file);
         return NULL;
@@ -78,21 +125,138 @@ t_bmp8* bmp8_loadImage(const char *filename) {
     fseek(file, dataOffset, SEEK_SET);
 
     // Read pixel data
-    if (fread(image->data, sizeof(unsigned char), dataSize, file) != dataSize) {
-        printf("Error: Failed to read image data.\n");
-        free(image->data);
-        free(image);
+    if (!stats) {
+        if (fread(image->data, sizeof(unsigned char), dataSize, file) != dataSize) {
+            printf("Error: Failed to read image data.\n");
+            free(image->data);
+            free(image);
+            fclose(file);
+            return NULL;
+        }
         fclose(file);
-        return NULL;
+        return image;
     }
 
+    // Read in chunks of whole rows and count each chunk while it is still in cache
+    unsigned int banks[BMP8_HIST_BANKS][256];
+    memset(banks, 0, sizeof(banks));
+    unsigned int chunkRows = rowSize ? BMP8_LOAD_CHUNK / rowSize : 0;
+    if (chunkRows == 0) chunkRows = 1;
+    for (unsigned int y = 0; y < height; y += chunkRows) {
+        unsigned int rows = (height - y < chunkRows) ? height - y : chunkRows;
+        unsigned char *chunk = image->data + (size_t)y * rowSize;
+        if (fread(chunk, rowSize, rows, file) != rows) {
+            printf("Error: Failed to read image data.\n");
+            free(image->data);
+            free(image);
+            fclose(file);
+            return NULL;
+        }
+        for (unsigned int r = 0; r < rows; r++) {
+            bmp8_countRow(banks, chunk + (size_t)r * rowSize, width);
+        }
+    }
     fclose(file);
+
+    // Min, max and sum follow from the histogram in O(256)
+    stats->min = 255;
+    stats->max = 0;
+    stats->sum = 0;
+    for (int i = 0; i < 256; i++) {
+        stats->histogram[i] = banks[0][i] + banks[1][i] + banks[2][i] + banks[3][i];
+        if (stats->histogram[i]) {
+            if (i < stats->min) stats->min = (unsigned char)i;
+            stats->max = (unsigned char)i;
+            stats->sum += (unsigned long long)i * stats->histogram[i];
+        }
+    }
+    return image;
+}
+
+t_bmp8* bmp8_loadImage(const char *filename) {
+    return bmp8_load(filename, NULL);
+}
+
+t_bmp8* bmp8_loadImageStats(const char *filename, t_bmp8_stats *stats) {
+    return bmp8_load(filename, stats);
+}
+
+/* Builds an image whose pixel data lives inside a mapping; takes ownership of it */
+static t_bmp8* bmp8_fromMapping(t_bmp_mapping *mapping, const char *filename) {
+    // Header and color table must both be inside the file
+    if (mapping->size < 54 + 1024) {
+        printf("Error: File %s is too small to be an 8-bit BMP.\n", filename);
+        bmp_unmapFile(mapping);
+        return NULL;
+    }
+
+    unsigned char *header = mapping->base;
+    unsigned int width = *(unsigned int *)&header[18];
+    unsigned int height = *(unsigned int *)&header[22];
+    unsigned short colorDepth = *(unsigned short *)&header[28];
+    unsigned int dataOffset = *(unsigned int *)&header[10];
+
+    if (colorDepth != 8) {
+        printf("Error: Image is not 8-bit grayscale (found %d-bit color depth).\n", colorDepth);
+        bmp_unmapFile(mapping);
+        return NULL;
+    }
+
+    unsigned int dataSize;
+    if (bmp8_checkSize(width, height, &dataSize) != 0) {
+        printf("Error: Invalid image size %ux%u in %s.\n", width, height, filename);
+        bmp_unmapFile(mapping);
+        return NULL;
+    }
+    if ((size_t)dataOffset + dataSize > mapping->size) {
+        printf("Error: Image data of %s is truncated.\n", filename);
+        bmp_unmapFile(mapping);
+        return NULL;
+    }
+
+    t_bmp8 *image = (t_bmp8*)malloc(sizeof(t_bmp8));
+    if (!image) {
+        printf("Error: Memory allocation failed.\n");
+        bmp_unmapFile(mapping);
+        return NULL;
+    }
+
+    image->width = width;
+    image->height = height;
+    image->colorDepth = colorDepth;
+    image->dataSize = dataSize;
+    image->mapping = *mapping;
+    memcpy(image->header, header, 54);
+    memcpy(image->colorTable, header + 54, 1024);
+
+    // Pixels are used in place, no copy
+    image->data = mapping->base + dataOffset;
+    return image;
+}
+
+t_bmp8* bmp8_mapImage(const char *filename, int mode) {
+    t_bmp_mapping mapping;
+    if (bmp_mapFile(filename, mode, &mapping) != 0) {
+        return NULL;
+    }
+    return bmp8_fromMapping(&mapping, filename);
+}
+
+t_bmp8* bmp8_mapCopy(const char *src, const char *dst) {
+    t_bmp_mapping mapping;
+    if (bmp_mapCopy(src, dst, &mapping) != 0) {
+        return NULL;
+    }
+    t_bmp8 *image = bmp8_fromMapping(&mapping, src);
+    if (!image) bmp_removeCopy(src, dst);
     return image;
 }
 
 void bmp8_free(t_bmp8 *img) {
     if (img) {
-        if (img->data) {
+        if (img->mapping.base) {
+            bmp_unmapFile(&img->mapping);
+        } else if (img->data) {
             free(img->data);
         }
         free(img);
@@ -113,6 +277,98 @@ void bmp8_printInfo(t_bmp8 *img) {
     printf("Data Size: %d bytes\n", img->dataSize);
 }
 
+t_bmp8* bmp8_loadRegion(const char *filename, unsigned int x, unsigned int y, unsigned int w, unsigned int h) {
+    int fd = bmp_openRead(filename);
+    if (fd < 0) {
+        printf("Error: Unable to open file %s\n", filename);
+        return NULL;
+    }
+
+    unsigned char header[54];
+    if (bmp_readAt(fd, header, 54, 0) != 0) {
+        printf("Error: Failed to read BMP header.\n");
+        bmp_closeRead(fd);
+        return NULL;
+    }
+
+    unsigned int width = *(unsigned int *)&header[18];
+    int fileHeight = *(int *)&header[22];
+    unsigned short colorDepth = *(unsigned short *)&header[28];
+    unsigned int dataOffset = *(unsigned int *)&header[10];
+    unsigned int height = (unsigned int)(fileHeight < 0 ? -fileHeight : fileHeight);
+
+    if (colorDepth != 8) {
+        printf("Error: Image is not 8-bit grayscale (found %d-bit color depth).\n", colorDepth);
+        bmp_closeRead(fd);
+        return NULL;
+    }
+    if (w == 0 || h == 0 || x >= width || y >= height || w > width - x || h > height - y) {
+        printf("Error: Region %ux%u at (%u, %u) is outside the %ux%u image.\n", w, h, x, y, width, height);
+        bmp_closeRead(fd);
+        return NULL;
+    }
+
+    t_bmp8 *image = (t_bmp8*)malloc(sizeof(t_bmp8));
+    if (!image) {
+        printf("Error: Memory allocation failed.\n");
+        bmp_closeRead(fd);
+        return NULL;
+    }
+
+    unsigned int srcRowSize = (width + 3) & ~3;
+    unsigned int rowSize = (w + 3) & ~3;
+    image->width = w;
+    image->height = h;
+    image->colorDepth = colorDepth;
+    image->dataSize = rowSize * h;
+    image->mapping.base = NULL;
+    image->mapping.size = 0;
+    image->data = (unsigned char*)calloc(image->dataSize, 1);
+    if (!image->data || bmp_readAt(fd, image->colorTable, 1024, 54) != 0) {
+        printf("Error: Failed to read color table.\n");
+        free(image->data);
+        free(image);
+        bmp_closeRead(fd);
+        return NULL;
+    }
+
+    // The crop is stored bottom-up like any BMP: its file row j is image row y + h - 1 - j
+    for (unsigned int j = 0; j < h; j++) {
+        unsigned int imageRow = y + h - 1 - j;
+        unsigned int srcRow = (fileHeight < 0) ? imageRow : height - 1 - imageRow;
+        unsigned long long offset = dataOffset + (unsigned long long)srcRow * srcRowSize + x;
+        if (bmp_readAt(fd, image->data + (size_t)j * rowSize, w, offset) != 0) {
+            printf("Error: Failed to read image data.\n");
+            free(image->data);
+            free(image);
+            bmp_closeRead(fd);
+            return NULL;
+        }
+    }
+    bmp_closeRead(fd);
+
+    // Header describing the crop as a standalone bottom-up image
+    memcpy(image->header, header, 54);
+    *(unsigned int *)&image->header[2] = 54 + 1024 + image->dataSize;
+    *(unsigned int *)&image->header[10] = 54 + 1024;
+    *(unsigned int *)&image->header[14] = 40;
+    *(unsigned int *)&image->header[18] = w;
+    *(unsigned int *)&image->header[22] = h;
+    *(unsigned int *)&image->header[34] = image->dataSize;
+    return image;
+}
+
+int bmp8_probe(const char *filename, t_bmp_probe *info) {
+    if (bmp_probe(filename, info) != 0) {
+        return -1;
+    }
+    if (info->colorDepth != 8) {
+        printf("Error: Image is not 8-bit grayscale (found %u-bit color depth).\n", info->colorDepth);
+        return -1;
+    }
+    return 0;
+}
+
 void bmp8_saveImage(const char *filename, t_bmp8 *img) {
     if (!img || !img->data) {
         printf("Error: Invalid image data.\n");
@@ -142,71 +398,213 @@ void bmp8_saveImage(const char *filename, t_bmp8 *img) {
 void bmp8_negative(t_bmp8 *img) {
     if (!img || !img->data) return;
 
-    for (unsigned int i = 0; i < img->dataSize; ++i) {
-        img->data[i] = 255 - img->data[i];
-    }
+    bmp_negativeBytes(img->data, img->dataSize);
 }
 
 void bmp8_brightness(t_bmp8 *img, int value) {
     if (!img || !img->data) return;
 
-    for (unsigned int i = 0; i < img->dataSize; ++i) {
-        int temp = img->data[i] + value;
+    bmp_brightnessBytes(img->data, img->dataSize, value);
+}
+
+void bmp8_threshold(t_bmp8 *img, int threshold) {
+    if (!img || !img->data) return;
+
+    bmp_thresholdBytes(img->data, img->dataSize, threshold);
+}
+
+/* Fused Point Operations */
+
+/*
+ * Each bmp8_lut* call composes one more operation onto the table, so a chain
+ * of any length costs a single sweep over the pixels in bmp8_applyLUT.
+ */
+void bmp8_lutInit(t_bmp8_lut *lut) {
+    for (int i = 0; i < 256; i++) {
+        lut->table[i] = (unsigned char)i;
+    }
+}
+
+void bmp8_lutNegative(t_bmp8_lut *lut) {
+    for (int i = 0; i < 256; i++) {
+        lut->table[i] = 255 - lut->table[i];
+    }
+}
+
+void bmp8_lutBrightness(t_bmp8_lut *lut, int value) {
+    for (int i = 0; i < 256; i++) {
+        int temp = lut->table[i] + value;
         if (temp > 255) temp = 255;
         if (temp < 0) temp = 0;
-        img->data[i] = (unsigned char)temp;
+        lut->table[i] = (unsigned char)temp;
     }
 }
 
-void bmp8_threshold(t_bmp8 *img, int threshold) {
+void bmp8_lutThreshold(t_bmp8_lut *lut, int threshold) {
+    for (int i = 0; i < 256; i++) {
+        lut->table[i] = (lut->table[i] > threshold) ? 255 : 0;
+    }
+}
+
+void bmp8_lutCurve(t_bmp8_lut *lut, const unsigned char *curve) {
+    for (int i = 0; i < 256; i++) {
+        lut->table[i] = curve[lut->table[i]];
+    }
+}
+
+/*
+ * hist is the histogram of the image the chain will be applied to. The
+ * histogram at this point of the chain follows from it without touching
+ * the pixels, by pushing every bin through the table built so far.
+ */
+int bmp8_lutEqualize(t_bmp8_lut *lut, const unsigned int *hist) {
+    unsigned int mapped[256] = {0};
+    unsigned int total = 0;
+    for (int i = 0; i < 256; i++) {
+        mapped[lut->table[i]] += hist[i];
+        total += hist[i];
+    }
+
+    unsigned int *cdf = bmp8_computeCDF(mapped, total);
+    if (!cdf) return -1;
+    for (int i = 0; i < 256; i++) {
+        lut->table[i] = (unsigned char)cdf[lut->table[i]];
+    }
+    free(cdf);
+    return 0;
+}
+
+void bmp8_applyLUT(t_bmp8 *img, const t_bmp8_lut *lut) {
     if (!img || !img->data) return;
 
     for (unsigned int i = 0; i < img->dataSize; ++i) {
-        img->data[i] = (img->data[i] > threshold) ? 255 : 0;
+        img->data[i] = lut->table[img->data[i]];
     }
 }
 
 /* Advanced Image Processing */
+/* Filters the interior of the image; rows and columns within size / 2 of the border are left as they are */
+static void bmp8_filterKernel(t_bmp8 *img, const t_bmp_kernel *kernel) {
+    int n = kernel->size / 2;
+    int width = (int)img->width;
+    int height = (int)img->height;
+    unsigned int rowSize = (img->width + 3) & ~3;
+
+    // Works in place from a few saved rows, so mapped files are filtered without a second image
+    bmp_convPlane(kernel, img->data, rowSize, width, height, 1, n, height - n, n, width - n);
+}
+
 void bmp8_applyFilter(t_bmp8 *img, float **kernel, int kernelSize) {
     if (!img || !img->data) return;
 
-    int n = kernelSize / 2;
-    unsigned int width = img->width;
-    unsigned int height = img->height;
-    unsigned int rowSize = (width + 3) & ~3;
+    t_bmp_kernel prepared;
+    if (bmp_kernelPrepare(&prepared, kernel, kernelSize) != 0) return;
+    bmp8_filterKernel(img, &prepared);
+    bmp_kernelRelease(&prepared);
+}
 
-    // Allocate memory for a copy of the original data
-    unsigned char *copy = (unsigned char *)malloc(img->dataSize);
-    if (!copy) {
-        printf("Error: Memory allocation for filter copy failed.\n");
+void bmp8_applyFilterBorder(t_bmp8 *img, float **kernel, int kernelSize, int mode, unsigned char value) {
+    if (!img || !img->data) return;
+    if (mode < BMP_BORDER_CONSTANT || mode > BMP_BORDER_WRAP) {
+        printf("Error: Unknown border mode %d.\n", mode);
         return;
     }
-    memcpy(copy, img->data, img->dataSize);
 
-    for (int y = n; y < (int)height - n; y++) {
-        for (int x = n; x < (int)width - n; x++) {
-            float sum = 0.0f;
+    t_bmp_kernel prepared;
+    if (bmp_kernelPrepare(&prepared, kernel, kernelSize) != 0) return;
+    unsigned int rowSize = (img->width + 3) & ~3;
+    bmp_convPlaneBorder(&prepared, img->data, rowSize, (int)img->width, (int)img->height, 1, mode, value);
+    bmp_kernelRelease(&prepared);
+}
 
-            for (int ky = -n; ky <= n; ky++) {
-                for (int kx = -n; kx <= n; kx++) {
-                    int ix = x + kx;
-                    int iy = y + ky;
-                    unsigned char pixel = copy[iy * rowSize + ix];
-                    sum += pixel * kernel[ky + n][kx + n];
-                }
-            }
+void bmp8_applySeparableFilter(t_bmp8 *img, const float *rowTaps, const float *colTaps, int kernelSize) {
+    if (!img || !img->data) return;
 
-            int result = (int)(sum + 0.5f);
-            if (result < 0) result = 0;
-            if (result > 255) result = 255;
+    t_bmp_kernel prepared;
+    if (bmp_kernelSeparable(&prepared, rowTaps, colTaps, kernelSize) != 0) return;
+    bmp8_filterKernel(img, &prepared);
+    bmp_kernelRelease(&prepared);
+}
+
+void bmp8_boxFilter(t_bmp8 *img, int radius) {
+    if (!img || !img->data) return;
+
+    unsigned int rowSize = (img->width + 3) & ~3;
+    bmp_boxFilterPlane(img->data, rowSize, (int)img->width, (int)img->height, 1, radius);
+}
+
+void bmp8_gaussianBlur(t_bmp8 *img, float sigma) {
+    if (!img || !img->data) return;
+
+    unsigned int rowSize = (img->width + 3) & ~3;
+    bmp_gaussianPlane(img->data, rowSize, (int)img->width, (int)img->height, 1, sigma);
+}
+
+/* Local Statistics */
+
+t_bmp_integral *bmp8_integral(const t_bmp8 *img) {
+    if (!img || !img->data || img->height == 0) return NULL;
+
+    // File rows are stored bottom-up, the tables use image rows from the top
+    unsigned int rowSize = (img->width + 3) & ~3;
+    return bmp_integralCreate(img->data + (size_t)(img->height - 1) * rowSize, -(ptrdiff_t)rowSize,
+                              (int)img->width, (int)img->height, 1);
+}
 
-            img->data[y * rowSize + x] = (unsigned char)result;
+void bmp8_adaptiveThreshold(t_bmp8 *img, int radius, int offset) {
+    t_bmp_integral *integral = bmp8_integral(img);
+    if (!integral) return;
+
+    int width = (int)img->width;
+    int height = (int)img->height;
+    unsigned int rowSize = (img->width + 3) & ~3;
+    int size = 2 * radius + 1;
+
+    // pixel > mean - offset, compared as (pixel + offset) * count > sum to stay in integers
+    #pragma omp parallel for schedule(static) if ((long)width * height >= BMP8_HIST_PARALLEL_MIN)
+    for (int y = 0; y < height; y++) {
+        unsigned char *row = img->data + (size_t)(height - 1 - y) * rowSize;
+        int y0 = y - radius > 0 ? y - radius : 0;
+        int y1 = y + radius < height - 1 ? y + radius : height - 1;
+        for (int x = 0; x < width; x++) {
+            int x0 = x - radius > 0 ? x - radius : 0;
+            int x1 = x + radius < width - 1 ? x + radius : width - 1;
+            int64_t count = (int64_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+            int64_t sum = (int64_t)bmp_integralSum(integral, x - radius, y - radius, size, size, 0);
+            row[x] = ((row[x] + offset) * count > sum) ? 255 : 0;
         }
     }
-    free(copy);
+    bmp_integralFree(integral);
 }
 
 /* Histogram Operations */
+/* Rows are split across threads, each with its own banked counters */
+/* Counts the pixels of img into hist (256 bins, overwritten) */
+static void bmp8_histogramInto(const t_bmp8 *img, unsigned int *hist) {
+    const unsigned char *data = img->data;
+    unsigned int width = img->width;
+    int height = (int)img->height;
+    unsigned int rowSize = (width + 3) & ~3;
+
+    memset(hist, 0, 256 * sizeof(unsigned int));
+
+    #pragma omp parallel if ((size_t)width * img->height >= BMP8_HIST_PARALLEL_MIN)
+    {
+        unsigned int local[BMP8_HIST_BANKS][256];
+        memset(local, 0, sizeof(local));
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; y++) {
+            bmp8_countRow(local, data + (size_t)y * rowSize, width);
+        }
+
+        #pragma omp critical
+        for (int i = 0; i < 256; i++) {
+            hist[i] += local[0][i] + local[1][i] + local[2][i] + local[3][i];
+        }
+    }
+}
+
 unsigned int *bmp8_computeHistogram(t_bmp8 *img) {
     unsigned int *hist = calloc(256, sizeof(unsigned int));
     if (!hist) {
@@ -214,10 +612,7 @@ unsigned int *bmp8_computeHistogram(t_bmp8 *img) {
         return NULL;
     }
 
-    for (unsigned int i = 0; i < img->dataSize; i++) {
-        hist[img->data[i]]++;
-    }
-
+    bmp8_histogramInto(img, hist);
     return hist;
 }
 
@@ -243,9 +638,17 @@ unsigned int *bmp8_computeCDF(unsigned int *hist, unsigned int total_pixels) {
         }
     }
 
-    // Normalize to get equalized histogram
+    // A single gray level has nothing to spread, keep it as is
+    if (total_pixels <= cdfmin) {
+        for (int i = 0; i < 256; i++) {
+            cdf[i] = i;
+        }
+        return cdf;
+    }
+
+    // Normalize to get equalized histogram; levels below the darkest pixel map to 0
     for (int i = 0; i < 256; i++) {
-        cdf[i] = round((double)(cdf[i] - cdfmin) / (total_pixels - cdfmin) * 255.0);
+        cdf[i] = cdf[i] < cdfmin ? 0 : round((double)(cdf[i] - cdfmin) / (total_pixels - cdfmin) * 255.0);
     }
 
     return cdf;
@@ -255,4 +658,258 @@ void bmp8_equalize(t_bmp8 *img, unsigned int *hist_eq) {
     for (unsigned int i = 0; i < img->dataSize; i++) {
         img->data[i] = (unsigned char)hist_eq[img->data[i]];
     }
-}
\ No newline at end of file
+}
+
+/* Adaptive Equalization */
+
+/* Clips a histogram at limit and spreads the excess evenly over all bins */
+static void bmp8_clipHistogram(unsigned int *hist, unsigned int limit) {
+    unsigned int excess = 0;
+    for (int i = 0; i < 256; i++) {
+        if (hist[i] > limit) {
+            excess += hist[i] - limit;
+            hist[i] = limit;
+        }
+    }
+
+    unsigned int share = excess / 256;
+    unsigned int rest = excess % 256;
+    for (int i = 0; i < 256; i++) {
+        hist[i] += share;
+    }
+    // Remainder goes to evenly spaced bins so the total is unchanged
+    if (rest > 0) {
+        unsigned int step = 256 / rest;
+        for (unsigned int i = 0; i < rest; i++) {
+            hist[i * step]++;
+        }
+    }
+}
+
+void bmp8_clahe(t_bmp8 *img, unsigned int tilesX, unsigned int tilesY, float clipLimit) {
+    if (!img || !img->data || img->width == 0 || img->height == 0) return;
+
+    unsigned int width = img->width;
+    unsigned int height = img->height;
+    unsigned int rowSize = (width + 3) & ~3;
+    if (tilesX == 0) tilesX = 1;
+    if (tilesY == 0) tilesY = 1;
+    if (tilesX > width) tilesX = width;
+    if (tilesY > height) tilesY = height;
+    unsigned int tileW = (width + tilesX - 1) / tilesX;
+    unsigned int tileH = (height + tilesY - 1) / tilesY;
+    // Rounding the tile size up can leave trailing tiles empty, drop them
+    tilesX = (width + tileW - 1) / tileW;
+    tilesY = (height + tileH - 1) / tileH;
+    int numTiles = (int)(tilesX * tilesY);
+
+    unsigned int *hists = (unsigned int *)calloc((size_t)numTiles * 256, sizeof(unsigned int));
+    unsigned char *luts = (unsigned char *)malloc((size_t)numTiles * 256);
+    int *xTile = (int *)malloc(width * sizeof(int));
+    float *xWeight = (float *)malloc(width * sizeof(float));
+    if (!hists || !luts || !xTile || !xWeight) {
+        printf("Error: Memory allocation for CLAHE failed.\n");
+        free(hists);
+        free(luts);
+        free(xTile);
+        free(xWeight);
+        return;
+    }
+
+    // Tile histograms in one pass; each band of tile rows belongs to one thread
+    int parallel = (size_t)width * height >= BMP8_HIST_PARALLEL_MIN;
+    #pragma omp parallel for schedule(dynamic) if (parallel)
+    for (int ty = 0; ty < (int)tilesY; ty++) {
+        unsigned int yEnd = (ty + 1) * tileH < height ? (ty + 1) * tileH : height;
+        for (unsigned int y = ty * tileH; y < yEnd; y++) {
+            const unsigned char *row = img->data + (size_t)y * rowSize;
+            for (unsigned int tx = 0; tx < tilesX; tx++) {
+                unsigned int *hist = hists + ((size_t)ty * tilesX + tx) * 256;
+                unsigned int xEnd = (tx + 1) * tileW < width ? (tx + 1) * tileW : width;
+                for (unsigned int x = tx * tileW; x < xEnd; x++) {
+                    hist[row[x]]++;
+                }
+            }
+        }
+    }
+
+    // Clipped histogram -> equalization table, per tile
+    #pragma omp parallel for schedule(dynamic) if (parallel)
+    for (int t = 0; t < numTiles; t++) {
+        unsigned int tx = t % tilesX;
+        unsigned int ty = t / tilesX;
+        unsigned int w = ((tx + 1) * tileW < width ? (tx + 1) * tileW : width) - tx * tileW;
+        unsigned int h = ((ty + 1) * tileH < height ? (ty + 1) * tileH : height) - ty * tileH;
+        unsigned int *hist = hists + (size_t)t * 256;
+        if (clipLimit > 0) {
+            unsigned int limit = (unsigned int)(clipLimit * w * h / 256.0f);
+            bmp8_clipHistogram(hist, limit > 0 ? limit : 1);
+        }
+        unsigned int *cdf = bmp8_computeCDF(hist, w * h);
+        for (int i = 0; i < 256; i++) {
+            luts[(size_t)t * 256 + i] = cdf ? (unsigned char)cdf[i] : (unsigned char)i;
+        }
+        free(cdf);
+    }
+
+    // Horizontal tile index and weight only depend on x
+    for (unsigned int x = 0; x < width; x++) {
+        float g = ((float)x + 0.5f) / tileW - 0.5f;
+        int t0 = (int)floorf(g);
+        float wgt = g - t0;
+        if (t0 < 0) { t0 = 0; wgt = 0; }
+        if (t0 >= (int)tilesX - 1) { t0 = tilesX - 1; wgt = 0; }
+        xTile[x] = t0;
+        xWeight[x] = wgt;
+    }
+
+    // Every pixel blends the tables of its four nearest tile centers
+    #pragma omp parallel for schedule(static) if (parallel)
+    for (int y = 0; y < (int)height; y++) {
+        float g = ((float)y + 0.5f) / tileH - 0.5f;
+        int ty0 = (int)floorf(g);
+        float wy = g - ty0;
+        if (ty0 < 0) { ty0 = 0; wy = 0; }
+        if (ty0 >= (int)tilesY - 1) { ty0 = tilesY - 1; wy = 0; }
+        int ty1 = (ty0 + 1 < (int)tilesY) ? ty0 + 1 : ty0;
+        const unsigned char *top = luts + (size_t)ty0 * tilesX * 256;
+        const unsigned char *bottom = luts + (size_t)ty1 * tilesX * 256;
+
+        unsigned char *row = img->data + (size_t)y * rowSize;
+        for (unsigned int x = 0; x < width; x++) {
+            int tx0 = xTile[x];
+            int tx1 = (tx0 + 1 < (int)tilesX) ? tx0 + 1 : tx0;
+            float wx = xWeight[x];
+            unsigned char v = row[x];
+            float a = top[tx0 * 256 + v] + wx * (top[tx1 * 256 + v] - top[tx0 * 256 + v]);
+            float b = bottom[tx0 * 256 + v] + wx * (bottom[tx1 * 256 + v] - bottom[tx0 * 256 + v]);
+            row[x] = (unsigned char)(a + wy * (b - a) + 0.5f);
+        }
+    }
+
+    free(hists);
+    free(luts);
+    free(xTile);
+    free(xWeight);
+}
+
+/* Automatic Thresholds */
+
+/* Maximizes the between-class variance w0 * w1 * (m0 - m1)^2 */
+int bmp8_otsuThreshold(const unsigned int *hist) {
+    double total = 0, sum = 0;
+    for (int i = 0; i < 256; i++) {
+        total += hist[i];
+        sum += (double)i * hist[i];
+    }
+
+    // A histogram with a single level has no split, that level is returned
+    double w0 = 0, sum0 = 0, best = -1;
+    int threshold = 0;
+    while (threshold < 255 && hist[threshold] == 0) threshold++;
+    for (int t = 0; t < 255; t++) {
+        w0 += hist[t];
+        sum0 += (double)t * hist[t];
+        double w1 = total - w0;
+        if (w0 == 0 || w1 == 0) continue;
+        double diff = sum0 / w0 - (sum - sum0) / w1;
+        double between = w0 * w1 * diff * diff;
+        if (between > best) {
+            best = between;
+            threshold = t;
+        }
+    }
+    return threshold;
+}
+
+/* Bin farthest below the line from the peak to the end of the longer tail */
+int bmp8_triangleThreshold(const unsigned int *hist) {
+    int lo = 0, hi = 255, peak = 0;
+    while (lo < 255 && hist[lo] == 0) lo++;
+    while (hi > 0 && hist[hi] == 0) hi--;
+    for (int i = lo; i <= hi; i++) {
+        if (hist[i] > hist[peak]) peak = i;
+    }
+    if (lo >= hi) return lo;
+
+    // End of the longer tail, the line runs from (end, hist[end]) to (peak, hist[peak])
+    int end = (peak - lo > hi - peak) ? lo : hi;
+    int step = (end < peak) ? 1 : -1;
+    long long span = (end < peak) ? peak - end : end - peak;
+    long long rise = (long long)hist[peak] - hist[end];
+
+    // Vertical distance below the line, scaled by span (same ordering as the perpendicular one)
+    long long best = -1;
+    int threshold = end;
+    for (int i = end; i != peak; i += step) {
+        long long run = (end < peak) ? i - end : end - i;
+        long long below = rise * run - ((long long)hist[i] - hist[end]) * span;
+        if (below > best) {
+            best = below;
+            threshold = i;
+        }
+    }
+    // With a right tail the object side starts just above the chosen bin
+    return (end < peak) ? threshold : (threshold > 0 ? threshold - 1 : 0);
+}
+
+/* Maximizes Yen's entropic correlation of the two classes */
+int bmp8_yenThreshold(const unsigned int *hist) {
+    int lo = 0, hi = 255;
+    while (lo < 255 && hist[lo] == 0) lo++;
+    while (hi > 0 && hist[hi] == 0) hi--;
+    if (lo >= hi) return lo;
+
+    double total = 0;
+    for (int i = lo; i <= hi; i++) total += hist[i];
+
+    // Cumulative mass and cumulative squared mass from below; squared mass above t from the top
+    double p1[256], p1sq[256], p2sq[256];
+    double acc = 0, accSq = 0;
+    for (int i = 0; i < 256; i++) {
+        double p = hist[i] / total;
+        acc += p;
+        accSq += p * p;
+        p1[i] = acc;
+        p1sq[i] = accSq;
+    }
+    p2sq[255] = 0;
+    for (int i = 254; i >= 0; i--) {
+        double p = hist[i + 1] / total;
+        p2sq[i] = p2sq[i + 1] + p * p;
+    }
+
+    double best = -INFINITY;
+    int threshold = 0;
+    for (int t = 0; t < 256; t++) {
+        double sq = p1sq[t] * p2sq[t];
+        double mass = p1[t] * (1.0 - p1[t]);
+        double crit = -(sq > 0 ? log(sq) : 0) + 2 * (mass > 0 ? log(mass) : 0);
+        if (crit > best) {
+            best = crit;
+            threshold = t;
+        }
+    }
+    return threshold;
+}
+
+int bmp8_autoThreshold(t_bmp8 *img, const unsigned int *hist, int method) {
+    if (!img || !img->data) return -1;
+
+    // Without a histogram one banked counting pass comes before the binarization pass
+    unsigned int counted[256];
+    if (!hist) {
+        bmp8_histogramInto(img, counted);
+        hist = counted;
+    }
+
+    int threshold;
+    switch (method) {
+        case BMP8_THRESHOLD_TRIANGLE: threshold = bmp8_triangleThreshold(hist); break;
+        case BMP8_THRESHOLD_YEN:      threshold = bmp8_yenThreshold(hist); break;
+        default:                      threshold = bmp8_otsuThreshold(hist); break;
+    }
+
+    bmp8_threshold(img, threshold);
+    return threshold;
+}
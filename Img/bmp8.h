@@ -11,6 +11,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "bmp_io.h"
+#include "bmp_integral.h"
+#include "bmp_conv.h"
 
 /**
  * Structure representing an 8-bit BMP image
@@ -23,25 +26,90 @@ typedef struct {
     unsigned int height;           ///< Height
     unsigned int colorDepth;       ///< Color depth
     unsigned int dataSize;         ///< Data size
+    t_bmp_mapping mapping;         ///< File mapping backing data (base is NULL for heap data)
 } t_bmp8;
 
+/**
+ * Lookup table for a chain of point operations
+ */
+typedef struct {
+    unsigned char table[256];      ///< Output value for each input value
+} t_bmp8_lut;
+
+/**
+ * Statistics gathered while loading an image
+ */
+typedef struct {
+    unsigned int histogram[256];   ///< Pixel value counts (row padding excluded)
+    unsigned char min;             ///< Smallest pixel value
+    unsigned char max;             ///< Largest pixel value
+    unsigned long long sum;        ///< Sum of all pixel values
+} t_bmp8_stats;
+
 /* Basic file operations */
 t_bmp8 * bmp8_loadImage(const char * filename);
+/* Same as bmp8_loadImage, also fills stats while the rows are read (no second pass) */
+t_bmp8 * bmp8_loadImageStats(const char * filename, t_bmp8_stats * stats);
+/* Zero-copy load: data points into a BMP_MAP_* mapping of the file until bmp8_free */
+t_bmp8 * bmp8_mapImage(const char * filename, int mode);
+/* Copies src to dst and maps dst with BMP_MAP_SHARED: operations then edit dst in place */
+t_bmp8 * bmp8_mapCopy(const char * src, const char * dst);
 void bmp8_saveImage(const char * filename, t_bmp8 * img);
 void bmp8_free(t_bmp8 * img);
 void bmp8_printInfo(t_bmp8 * img);
+/* Reads only the w x h crop at (x, y) (y counted from the top) with positioned reads */
+t_bmp8 * bmp8_loadRegion(const char * filename, unsigned int x, unsigned int y, unsigned int w, unsigned int h);
+/* Header-only read, returns 0 if filename is an 8-bit BMP */
+int bmp8_probe(const char * filename, t_bmp_probe * info);
 
 /* Basic image transformations */
 void bmp8_negative(t_bmp8 * img);
 void bmp8_brightness(t_bmp8 * img, int value);
 void bmp8_threshold(t_bmp8 * img, int threshold);
 
+/* Fused point operations: build a chain into one table, then apply it in a single pass */
+void bmp8_lutInit(t_bmp8_lut * lut);
+void bmp8_lutNegative(t_bmp8_lut * lut);
+void bmp8_lutBrightness(t_bmp8_lut * lut, int value);
+void bmp8_lutThreshold(t_bmp8_lut * lut, int threshold);
+void bmp8_lutCurve(t_bmp8_lut * lut, const unsigned char * curve);
+int bmp8_lutEqualize(t_bmp8_lut * lut, const unsigned int * hist);
+void bmp8_applyLUT(t_bmp8 * img, const t_bmp8_lut * lut);
+
 /* Advanced image processing */
+/* Large non-separable kernels (17 taps and more) may go through the FFT, within one level of the direct filter */
 void bmp8_applyFilter(t_bmp8 *img, float **kernel, int kernelSize);
+/* Same filter given as its row and column factors (rank-1 kernels are also detected by bmp8_applyFilter) */
+void bmp8_applySeparableFilter(t_bmp8 *img, const float *rowTaps, const float *colTaps, int kernelSize);
+/* Filters every pixel, including the border, seeing BMP_BORDER_* mode outside the image (value for CONSTANT) */
+void bmp8_applyFilterBorder(t_bmp8 *img, float **kernel, int kernelSize, int mode, unsigned char value);
+/* Mean of the (2 * radius + 1)^2 window over the pixels inside the image, same cost for any radius
+   (the image is left as is when the radius within it is above BMP_BOX_MAX_RADIUS) */
+void bmp8_boxFilter(t_bmp8 *img, int radius);
+/* Gaussian blur by a recursive filter, same cost for any sigma (edges are extended, within two levels of exact,
+   scratch per thread of 64 doubles per row plus one row of doubles) */
+void bmp8_gaussianBlur(t_bmp8 *img, float sigma);
+
+/* Local statistics: summed-area tables in image coordinates (top row first) */
+t_bmp_integral *bmp8_integral(const t_bmp8 *img);
+/* Binarizes each pixel against the mean of its (2 * radius + 1)^2 window minus offset */
+void bmp8_adaptiveThreshold(t_bmp8 *img, int radius, int offset);
 
 /* Histogram operations for contrast enhancement */
 unsigned int *bmp8_computeHistogram(t_bmp8 *img);
 unsigned int *bmp8_computeCDF(unsigned int *hist, unsigned int total_pixels);
 void bmp8_equalize(t_bmp8 *img, unsigned int *hist_eq);
+/* Contrast-limited adaptive equalization over a tilesX x tilesY grid; clipLimit is a multiple of the mean bin height (<= 0 disables clipping) */
+void bmp8_clahe(t_bmp8 *img, unsigned int tilesX, unsigned int tilesY, float clipLimit);
+
+/* Threshold selection in O(256) from a histogram; pixels above the returned value are foreground */
+#define BMP8_THRESHOLD_OTSU 0
+#define BMP8_THRESHOLD_TRIANGLE 1
+#define BMP8_THRESHOLD_YEN 2
+int bmp8_otsuThreshold(const unsigned int *hist);
+int bmp8_triangleThreshold(const unsigned int *hist);
+int bmp8_yenThreshold(const unsigned int *hist);
+/* Binarizes with an automatic threshold and returns it; hist may be NULL, it is then counted first */
+int bmp8_autoThreshold(t_bmp8 *img, const unsigned int *hist, int method);
 
 #endif //BMP8_H
@@ -0,0 +1,901 @@
+/**
+ * Implementation of the convolution engine
+ *
+ * Rows are filtered as whole byte runs: every kernel tap is one pass of
+ * acc[b] += coeff * row[b + offset] over the row, which keeps the inner loops
+ * free of bounds checks and lets the compiler vectorize them.
+ */
+
+#include "bmp_conv.h"
+#include "bmp_simd.h"
+#include "bmp_fft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Kernel Preparation */
+
+/* Relative error allowed when matching a kernel against column x row */
+#define BMP_CONV_RANK1_TOLERANCE 1e-5f
+
+static int bmp_kernelAlloc(t_bmp_kernel *kernel, int size) {
+    memset(kernel, 0, sizeof(*kernel));
+    if (size < 1 || size % 2 == 0) {
+        printf("Error: Kernel size must be odd.\n");
+        return -1;
+    }
+    kernel->size = size;
+    kernel->taps = (float *)malloc((size_t)size * size * sizeof(float));
+    kernel->rowTaps = (float *)malloc((size_t)size * sizeof(float));
+    kernel->colTaps = (float *)malloc((size_t)size * sizeof(float));
+    if (!kernel->taps || !kernel->rowTaps || !kernel->colTaps) {
+        printf("Error: Memory allocation for kernel failed.\n");
+        bmp_kernelRelease(kernel);
+        return -1;
+    }
+    return 0;
+}
+
+/* Factors the kernel through its largest coefficient and checks the rank-1 reconstruction */
+static int bmp_kernelIsRank1(t_bmp_kernel *kernel) {
+    int k = kernel->size;
+    const float *taps = kernel->taps;
+    int pr = 0, pc = 0;
+    float maxAbs = 0;
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) {
+            if (fabsf(taps[i * k + j]) > maxAbs) {
+                maxAbs = fabsf(taps[i * k + j]);
+                pr = i;
+                pc = j;
+            }
+        }
+    }
+    if (maxAbs == 0) return 0;
+
+    for (int i = 0; i < k; i++) {
+        kernel->colTaps[i] = taps[i * k + pc];
+        kernel->rowTaps[i] = taps[pr * k + i] / taps[pr * k + pc];
+    }
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) {
+            if (fabsf(taps[i * k + j] - kernel->colTaps[i] * kernel->rowTaps[j]) > BMP_CONV_RANK1_TOLERANCE * maxAbs) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+ * Looks for the smallest D (up to 1024, then powers of two up to 16384) making
+ * every tap an integer, within float precision. The integer sums must stay in
+ * 31 bits and every product in a 16-bit multiply.
+ */
+static int bmp_kernelQuantize(t_bmp_kernel *kernel) {
+    int taps = kernel->size * kernel->size;
+    if (kernel->size > BMP_CONV_INT_MAX_SIZE) return 0;
+
+    for (int d = 1; d <= 16384; d = (d < 1024) ? d + 1 : d * 2) {
+        double magnitude = 0;
+        int exact = 1;
+        for (int t = 0; t < taps && exact; t++) {
+            double scaled = (double)kernel->taps[t] * d;
+            double rounded = floor(scaled + 0.5);
+            exact = fabs(scaled - rounded) <= 1e-5 * (fabs(rounded) + 1) && fabs(rounded) <= 32767;
+            magnitude += fabs(rounded);
+        }
+        if (!exact || magnitude * 255 >= 2147483647.0 - d) continue;
+
+        kernel->intTaps = (int16_t *)malloc((size_t)taps * sizeof(int16_t));
+        if (!kernel->intTaps) return 0;
+        for (int t = 0; t < taps; t++) {
+            kernel->intTaps[t] = (int16_t)floor((double)kernel->taps[t] * d + 0.5);
+        }
+        return d;
+    }
+    return 0;
+}
+
+int bmp_kernelPrepare(t_bmp_kernel *kernel, float **taps, int size) {
+    if (bmp_kernelAlloc(kernel, size) != 0) return -1;
+    for (int i = 0; i < size; i++) {
+        memcpy(kernel->taps + (size_t)i * size, taps[i], size * sizeof(float));
+    }
+    // A 1x1 kernel costs one multiply either way
+    kernel->separable = size > 1 && bmp_kernelIsRank1(kernel);
+    kernel->divisor = bmp_kernelQuantize(kernel);
+    return 0;
+}
+
+int bmp_kernelSeparable(t_bmp_kernel *kernel, const float *rowTaps, const float *colTaps, int size) {
+    if (bmp_kernelAlloc(kernel, size) != 0) return -1;
+    memcpy(kernel->rowTaps, rowTaps, size * sizeof(float));
+    memcpy(kernel->colTaps, colTaps, size * sizeof(float));
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            kernel->taps[i * size + j] = colTaps[i] * rowTaps[j];
+        }
+    }
+    kernel->separable = 1;
+    kernel->divisor = bmp_kernelQuantize(kernel);
+    return 0;
+}
+
+void bmp_kernelRelease(t_bmp_kernel *kernel) {
+    free(kernel->taps);
+    free(kernel->rowTaps);
+    free(kernel->colTaps);
+    free(kernel->intTaps);
+    memset(kernel, 0, sizeof(*kernel));
+}
+
+/* Row Filtering */
+
+size_t bmp_convScratchSize(const t_bmp_kernel *kernel, int width, int channels) {
+    // Padded vertical pass plus accumulator
+    return ((size_t)2 * width + kernel->size) * channels;
+}
+
+/* Rounds to nearest and clamps to a byte */
+static inline uint8_t bmp_convRound(float sum) {
+    if (sum <= 0) return 0;
+    if (sum >= 255) return 255;
+    return (uint8_t)(int)(sum + 0.5f);
+}
+
+/*
+ * The row paths below read input bytes in [lo, hi) only: [0, rowBytes) for
+ * zero padding, or the whole padded row for the border modes, in which case
+ * no tap is ever clipped.
+ */
+
+/* acc[b - b0] += coeff * row[b + offset] for every b in [b0, b1) where row[b + offset] exists */
+static inline void bmp_convTap(float *acc, const uint8_t *row, float coeff, int offset, int b0, int b1, int lo, int hi) {
+    int first = b0 > lo - offset ? b0 : lo - offset;
+    int end = b1 < hi - offset ? b1 : hi - offset;
+    for (int b = first; b < end; b++) {
+        acc[b - b0] += coeff * row[b + offset];
+    }
+}
+
+/* Full k x k sum, accumulated in the same order as a per-pixel loop */
+static void bmp_convRow2D(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                          int lo, int hi, int channels, int b0, int b1, float *acc) {
+    int k = kernel->size;
+    int n = k / 2;
+    memset(acc, 0, (size_t)(b1 - b0) * sizeof(float));
+    for (int i = 0; i < k; i++) {
+        if (!rows[i]) continue;
+        for (int j = 0; j < k; j++) {
+            bmp_convTap(acc, rows[i], kernel->taps[i * k + j], (j - n) * channels, b0, b1, lo, hi);
+        }
+    }
+    for (int b = b0; b < b1; b++) {
+        out[b] = bmp_convRound(acc[b - b0]);
+    }
+}
+
+/* Vertical 1-D pass into a zero-padded float row, then horizontal 1-D pass: 2k taps per pixel */
+static void bmp_convRowSeparable(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                                 int lo, int hi, int channels, int b0, int b1, float *scratch) {
+    int k = kernel->size;
+    int pad = (k / 2) * channels;
+    float *column = scratch + pad;  // column[b] valid for b in [b0 - pad, b1 + pad)
+    float *acc = column + b1 + pad;
+
+    int t0 = b0 - pad, t1 = b1 + pad;
+    int first = t0 > lo ? t0 : lo;
+    int end = t1 < hi ? t1 : hi;
+    for (int b = t0; b < first; b++) column[b] = 0;
+    for (int b = end; b < t1; b++) column[b] = 0;
+    memset(column + first, 0, (size_t)(end - first) * sizeof(float));
+    for (int i = 0; i < k; i++) {
+        if (!rows[i]) continue;
+        const uint8_t *row = rows[i];
+        float coeff = kernel->colTaps[i];
+        for (int b = first; b < end; b++) {
+            column[b] += coeff * row[b];
+        }
+    }
+
+    memset(acc, 0, (size_t)(b1 - b0) * sizeof(float));
+    for (int j = 0; j < k; j++) {
+        const float *src = column + (j * channels - pad);
+        float coeff = kernel->rowTaps[j];
+        for (int b = b0; b < b1; b++) {
+            acc[b - b0] += coeff * src[b];
+        }
+    }
+    for (int b = b0; b < b1; b++) {
+        out[b] = bmp_convRound(acc[b - b0]);
+    }
+}
+
+/* Exactly rounded fraction, the scalar counterpart of bmp_weightedSumBytes */
+static inline uint8_t bmp_convRoundInt(int32_t sum, int divisor) {
+    if (sum <= 0) return 0;
+    if (sum >= 255 * divisor) return 255;
+    return (uint8_t)((sum + divisor / 2) / divisor);
+}
+
+/*
+ * Integer taps: the interior, where every tap is inside [lo, hi), goes through
+ * the SIMD weighted sum; only the thin band near the left and right edges
+ * checks its taps one by one.
+ */
+static void bmp_convRowInt(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                           int lo, int hi, int channels, int b0, int b1) {
+    int k = kernel->size;
+    int n = k / 2;
+    int pad = n * channels;
+    int in0 = b0 > lo + pad ? b0 : lo + pad;
+    int in1 = b1 < hi - pad ? b1 : hi - pad;
+
+    if (in0 < in1) {
+        const uint8_t *src[BMP_CONV_INT_MAX_SIZE * BMP_CONV_INT_MAX_SIZE];
+        int16_t weights[BMP_CONV_INT_MAX_SIZE * BMP_CONV_INT_MAX_SIZE];
+        int taps = 0;
+        for (int i = 0; i < k; i++) {
+            if (!rows[i]) continue;
+            for (int j = 0; j < k; j++) {
+                if (kernel->intTaps[i * k + j] == 0) continue;
+                src[taps] = rows[i] + in0 + (j - n) * channels;
+                weights[taps++] = kernel->intTaps[i * k + j];
+            }
+        }
+        bmp_weightedSumBytes(out + in0, src, weights, taps, in1 - in0, kernel->divisor);
+    } else {
+        in0 = in1 = b1;
+    }
+
+    for (int b = b0; b < b1; b++) {
+        if (b == in0) b = in1;
+        if (b >= b1) break;
+        int32_t sum = 0;
+        for (int i = 0; i < k; i++) {
+            if (!rows[i]) continue;
+            for (int j = 0; j < k; j++) {
+                int src = b + (j - n) * channels;
+                if (src < lo || src >= hi) continue;
+                sum += kernel->intTaps[i * k + j] * rows[i][src];
+            }
+        }
+        out[b] = bmp_convRoundInt(sum, kernel->divisor);
+    }
+}
+
+/* Unrolled Kernels */
+
+/*
+ * 3 x 3 and 5 x 5 float kernels with the taps held in locals and the channel
+ * step a constant, one function per size and pixel format. Taps are added in
+ * the order of bmp_convRow2D, so the results are the same bit for bit. Sums
+ * go to acc and are rounded afterwards, which keeps the sum loop free of
+ * branches so the compiler can vectorize it. Only pixels whose taps are all
+ * inside the input rows come here.
+ */
+#define BMP_CONV_TAPS3(r, i, C) \
+    s += t[(i) * 3 + 0] * r[b - (C)]; \
+    s += t[(i) * 3 + 1] * r[b]; \
+    s += t[(i) * 3 + 2] * r[b + (C)];
+#define BMP_CONV_TAPS5(r, i, C) \
+    s += t[(i) * 5 + 0] * r[b - 2 * (C)]; \
+    s += t[(i) * 5 + 1] * r[b - (C)]; \
+    s += t[(i) * 5 + 2] * r[b]; \
+    s += t[(i) * 5 + 3] * r[b + (C)]; \
+    s += t[(i) * 5 + 4] * r[b + 2 * (C)];
+
+#define BMP_CONV_UNROLLED3(C) \
+static void bmp_convRow3x3_##C(const float *taps, const uint8_t *const *rows, float *acc, int b0, int b1) { \
+    float t[9]; \
+    memcpy(t, taps, sizeof(t)); \
+    const uint8_t *r0 = rows[0], *r1 = rows[1], *r2 = rows[2]; \
+    for (int b = b0; b < b1; b++) { \
+        float s = 0; \
+        BMP_CONV_TAPS3(r0, 0, C) \
+        BMP_CONV_TAPS3(r1, 1, C) \
+        BMP_CONV_TAPS3(r2, 2, C) \
+        acc[b - b0] = s; \
+    } \
+}
+
+#define BMP_CONV_UNROLLED5(C) \
+static void bmp_convRow5x5_##C(const float *taps, const uint8_t *const *rows, float *acc, int b0, int b1) { \
+    float t[25]; \
+    memcpy(t, taps, sizeof(t)); \
+    const uint8_t *r0 = rows[0], *r1 = rows[1], *r2 = rows[2], *r3 = rows[3], *r4 = rows[4]; \
+    for (int b = b0; b < b1; b++) { \
+        float s = 0; \
+        BMP_CONV_TAPS5(r0, 0, C) \
+        BMP_CONV_TAPS5(r1, 1, C) \
+        BMP_CONV_TAPS5(r2, 2, C) \
+        BMP_CONV_TAPS5(r3, 3, C) \
+        BMP_CONV_TAPS5(r4, 4, C) \
+        acc[b - b0] = s; \
+    } \
+}
+
+BMP_CONV_UNROLLED3(1)
+BMP_CONV_UNROLLED3(3)
+BMP_CONV_UNROLLED5(1)
+BMP_CONV_UNROLLED5(3)
+
+typedef void (*t_bmp_convUnrolled)(const float *taps, const uint8_t *const *rows, float *acc, int b0, int b1);
+
+/* Indexed by [size == 5][channels == 3] */
+static const t_bmp_convUnrolled bmp_convUnrolled[2][2] = {
+    {bmp_convRow3x3_1, bmp_convRow3x3_3},
+    {bmp_convRow5x5_1, bmp_convRow5x5_3},
+};
+
+/* Unrolled interior, bmp_convRow2D on the few bytes near the edges and for rows outside the image */
+static void bmp_convRowSmall(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                             int lo, int hi, int channels, int b0, int b1, float *acc) {
+    int k = kernel->size;
+    int pad = (k / 2) * channels;
+    for (int i = 0; i < k; i++) {
+        if (!rows[i]) {
+            bmp_convRow2D(kernel, rows, out, lo, hi, channels, b0, b1, acc);
+            return;
+        }
+    }
+
+    int in0 = b0 > lo + pad ? b0 : lo + pad;
+    int in1 = b1 < hi - pad ? b1 : hi - pad;
+    if (in0 >= in1) {
+        bmp_convRow2D(kernel, rows, out, lo, hi, channels, b0, b1, acc);
+        return;
+    }
+    if (b0 < in0) bmp_convRow2D(kernel, rows, out, lo, hi, channels, b0, in0, acc);
+    bmp_convUnrolled[k == 5][channels == 3](kernel->taps, rows, acc, in0, in1);
+    for (int b = in0; b < in1; b++) {
+        out[b] = bmp_convRound(acc[b - in0]);
+    }
+    if (in1 < b1) bmp_convRow2D(kernel, rows, out, lo, hi, channels, in1, b1, acc);
+}
+
+/* Picks the path for the kernel; input bytes outside [lo, hi) count as zero */
+static void bmp_convRowRange(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                             int lo, int hi, int channels, int b0, int b1, float *scratch) {
+    // Exact integer taps unless a long separable kernel is cheaper as two float passes
+    if (kernel->divisor && (!kernel->separable || kernel->size <= 5)) {
+        bmp_convRowInt(kernel, rows, out, lo, hi, channels, b0, b1);
+    } else if (kernel->separable) {
+        bmp_convRowSeparable(kernel, rows, out, lo, hi, channels, b0, b1, scratch);
+    } else if (kernel->size == 3 || kernel->size == 5) {
+        bmp_convRowSmall(kernel, rows, out, lo, hi, channels, b0, b1, scratch);
+    } else {
+        bmp_convRow2D(kernel, rows, out, lo, hi, channels, b0, b1, scratch);
+    }
+}
+
+void bmp_convRow(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                 int width, int channels, int x0, int x1, float *scratch) {
+    if (x0 < 0) x0 = 0;
+    if (x1 > width) x1 = width;
+    if (x0 >= x1) return;
+
+    bmp_convRowRange(kernel, rows, out, 0, width * channels, channels, x0 * channels, x1 * channels, scratch);
+}
+
+void bmp_convRowPadded(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                       int width, int channels, float *scratch) {
+    int pad = (kernel->size / 2) * channels;
+    bmp_convRowRange(kernel, rows, out, -pad, width * channels + pad, channels, 0, width * channels, scratch);
+}
+
+/* Whole Planes */
+
+/*
+ * Every thread filters one band of rows top to bottom. Output row y may only
+ * overwrite its input once rows y + 1 .. y + n no longer need it, so the
+ * originals of rows y - n .. y live in a ring of n + 1 rows. The rows just
+ * above and below a band belong to the neighbouring bands, which overwrite
+ * them; each thread copies them before a barrier. Scratch per thread is
+ * 2n + 1 rows, whatever the image height.
+ */
+int bmp_convPlane(const t_bmp_kernel *kernel, uint8_t *data, ptrdiff_t stride, int width, int height,
+                  int channels, int y0, int y1, int x0, int x1) {
+    int k = kernel->size;
+    int n = k / 2;
+    size_t rowBytes = (size_t)width * channels;
+    int failed = 0;
+    if (y0 < 0) y0 = 0;
+    if (y1 > height) y1 = height;
+    if (y0 >= y1 || x0 >= x1) return 0;
+
+    // Large non-separable kernels are cheaper through overlap-save FFT tiles
+    int tileSize = bmp_fftTileSize(kernel, (x1 < width ? x1 : width) - (x0 > 0 ? x0 : 0), y1 - y0);
+    if (tileSize) {
+        return bmp_fftConvPlane(kernel, data, stride, width, height, channels, y0, y1, x0, x1, tileSize);
+    }
+
+    #pragma omp parallel if ((long)width * (y1 - y0) >= BMP_CONV_PARALLEL_MIN)
+    {
+        int threads = 1, id = 0;
+#ifdef _OPENMP
+        threads = omp_get_num_threads();
+        id = omp_get_thread_num();
+#endif
+        int b0 = y0 + (int)((long)(y1 - y0) * id / threads);
+        int b1 = y0 + (int)((long)(y1 - y0) * (id + 1) / threads);
+
+        uint8_t *ring = (uint8_t *)malloc((size_t)(2 * n + 1) * rowBytes);
+        uint8_t *below = ring + (size_t)(n + 1) * rowBytes;
+        // Row pointers live on the stack up to BMP_CONV_MAX_KERNEL rows
+        const uint8_t *fixedRows[BMP_CONV_MAX_KERNEL];
+        const uint8_t **rows = fixedRows;
+        if (k > BMP_CONV_MAX_KERNEL) rows = (const uint8_t **)malloc((size_t)k * sizeof(*rows));
+        float *scratch = (float *)malloc(bmp_convScratchSize(kernel, width, channels) * sizeof(float));
+        if (!ring || !scratch || !rows) {
+            #pragma omp atomic write
+            failed = 1;
+        } else if (b0 < b1) {
+            for (int r = b0 - n; r < b0; r++) {
+                if (r >= 0) memcpy(ring + (size_t)(r % (n + 1)) * rowBytes, data + r * stride, rowBytes);
+            }
+            for (int r = b1; r < b1 + n && r < height; r++) {
+                memcpy(below + (size_t)(r - b1) * rowBytes, data + r * stride, rowBytes);
+            }
+        }
+
+        #pragma omp barrier
+
+        if (ring && scratch && rows && b0 < b1) {
+            for (int y = b0; y < b1; y++) {
+                uint8_t *line = data + y * stride;
+                memcpy(ring + (size_t)(y % (n + 1)) * rowBytes, line, rowBytes);
+                for (int i = 0; i < k; i++) {
+                    int src = y - n + i;
+                    if (src < 0 || src >= height) rows[i] = NULL;
+                    else if (src <= y) rows[i] = ring + (size_t)(src % (n + 1)) * rowBytes;
+                    else if (src < b1) rows[i] = data + src * stride;
+                    else rows[i] = below + (size_t)(src - b1) * rowBytes;
+                }
+                bmp_convRow(kernel, rows, line, width, channels, x0, x1, scratch);
+            }
+        }
+        if (rows != fixedRows) free(rows);
+        free(ring);
+        free(scratch);
+    }
+
+    if (failed) {
+        printf("Error: Memory allocation for filter rows failed.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Border Modes */
+
+/* Source index of position i in a line of size pixels, -1 for the constant */
+static int bmp_borderIndex(int i, int size, int mode) {
+    if (i >= 0 && i < size) return i;
+    switch (mode) {
+        case BMP_BORDER_CLAMP:
+            return i < 0 ? 0 : size - 1;
+        case BMP_BORDER_MIRROR: {
+            if (size == 1) return 0;
+            int period = 2 * (size - 1);
+            i %= period;
+            if (i < 0) i += period;
+            return i < size ? i : period - i;
+        }
+        case BMP_BORDER_WRAP:
+            i %= size;
+            return i < 0 ? i + size : i;
+        default:
+            return -1;
+    }
+}
+
+/* Copies source row r (after the vertical border mapping) into a padded row, filling the padding */
+static void bmp_borderLoadRow(uint8_t *padded, const uint8_t *data, ptrdiff_t stride, int width, int height,
+                              int channels, int n, int r, int mode, uint8_t value) {
+    size_t rowBytes = (size_t)width * channels;
+    int src = bmp_borderIndex(r, height, mode);
+    if (src < 0) {
+        memset(padded - n * channels, value, rowBytes + 2 * n * channels);
+        return;
+    }
+    const uint8_t *line = data + src * stride;
+    memcpy(padded, line, rowBytes);
+    for (int p = 1; p <= n; p++) {
+        int left = bmp_borderIndex(-p, width, mode);
+        int right = bmp_borderIndex(width - 1 + p, width, mode);
+        for (int c = 0; c < channels; c++) {
+            padded[(-p) * channels + c] = left < 0 ? value : line[left * channels + c];
+            padded[(width - 1 + p) * channels + c] = right < 0 ? value : line[right * channels + c];
+        }
+    }
+}
+
+/*
+ * Same band scheme as bmp_convPlane, but the ring holds all k rows of the
+ * window as padded copies, so bmp_convRowPadded never clips a tap. Rows
+ * outside the image are mapped before anything is overwritten: they can come
+ * from any band (wrap reaches the opposite edge).
+ */
+int bmp_convPlaneBorder(const t_bmp_kernel *kernel, uint8_t *data, ptrdiff_t stride, int width, int height,
+                        int channels, int mode, uint8_t value) {
+    int k = kernel->size;
+    int n = k / 2;
+    size_t paddedBytes = (size_t)(width + 2 * n) * channels;
+    int failed = 0;
+    if (width <= 0 || height <= 0) return 0;
+
+    #pragma omp parallel if ((long)width * height >= BMP_CONV_PARALLEL_MIN)
+    {
+        int threads = 1, id = 0;
+#ifdef _OPENMP
+        threads = omp_get_num_threads();
+        id = omp_get_thread_num();
+#endif
+        int b0 = (int)((long)height * id / threads);
+        int b1 = (int)((long)height * (id + 1) / threads);
+
+        // Ring of k padded rows, then n padded rows below the band
+        uint8_t *buffer = (uint8_t *)malloc((size_t)(k + n) * paddedBytes);
+        float *scratch = (float *)malloc(bmp_convScratchSize(kernel, width, channels) * sizeof(float));
+        #define BMP_RING_ROW(v) (buffer + (size_t)(((v) % k + k) % k) * paddedBytes + n * channels)
+        #define BMP_BELOW_ROW(v) (buffer + (size_t)(k + (v) - b1) * paddedBytes + n * channels)
+        const uint8_t *fixedRows[BMP_CONV_MAX_KERNEL];
+        const uint8_t **rows = fixedRows;
+        if (k > BMP_CONV_MAX_KERNEL) rows = (const uint8_t **)malloc((size_t)k * sizeof(*rows));
+        if (!buffer || !scratch || !rows) {
+            #pragma omp atomic write
+            failed = 1;
+        } else if (b0 < b1) {
+            for (int v = b0 - n; v < b0; v++) {
+                bmp_borderLoadRow(BMP_RING_ROW(v), data, stride, width, height, channels, n, v, mode, value);
+            }
+            for (int v = b1; v < b1 + n; v++) {
+                bmp_borderLoadRow(BMP_BELOW_ROW(v), data, stride, width, height, channels, n, v, mode, value);
+            }
+        }
+
+        #pragma omp barrier
+
+        if (buffer && scratch && rows && b0 < b1) {
+            // Rows b0 .. b0 + n - 1 of the window, then one more per output row
+            for (int v = b0; v < b0 + n; v++) {
+                if (v < b1) bmp_borderLoadRow(BMP_RING_ROW(v), data, stride, width, height, channels, n, v, mode, value);
+            }
+            for (int y = b0; y < b1; y++) {
+                int v = y + n;
+                if (v < b1) bmp_borderLoadRow(BMP_RING_ROW(v), data, stride, width, height, channels, n, v, mode, value);
+                for (int i = 0; i < k; i++) {
+                    int src = y - n + i;
+                    rows[i] = (src < b1) ? BMP_RING_ROW(src) : BMP_BELOW_ROW(src);
+                }
+                bmp_convRowPadded(kernel, rows, data + y * stride, width, channels, scratch);
+            }
+        }
+        #undef BMP_RING_ROW
+        #undef BMP_BELOW_ROW
+        if (rows != fixedRows) free(rows);
+        free(buffer);
+        free(scratch);
+    }
+
+    if (failed) {
+        printf("Error: Memory allocation for filter rows failed.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Box Filter */
+
+/*
+ * Output row y needs the horizontal sums of rows y - r .. y + r. The ring
+ * holds 2r + 1 of them: the slot of row y + r is the one row y - r - 1 leaves,
+ * so each step subtracts the old slot and refills it. Rows below y are only
+ * read through the ring, which lets the result overwrite the input.
+ */
+/* Horizontal running sums of one row into dst, also added to the column sums */
+static void bmp_boxLoadRow(const uint8_t *src, uint32_t *dst, uint32_t *column, int width, int channels, int rx) {
+    for (int c = 0; c < channels; c++) {
+        uint32_t sum = 0;
+        for (int x = 0; x <= rx; x++) sum += src[x * channels + c];
+        for (int x = 0; x < width; x++) {
+            dst[x * channels + c] = sum;
+            if (x + rx + 1 < width) sum += src[(x + rx + 1) * channels + c];
+            if (x - rx >= 0) sum -= src[(x - rx) * channels + c];
+        }
+    }
+    for (size_t b = 0; b < (size_t)width * channels; b++) {
+        column[b] += dst[b];
+    }
+}
+
+int bmp_boxFilterPlane(uint8_t *data, size_t stride, int width, int height, int channels, int radius) {
+    if (radius <= 0 || width <= 0 || height <= 0) return 0;
+    // A window wider or taller than the image is the whole image in that direction
+    int rx = radius < width - 1 ? radius : width - 1;
+    int ry = radius < height - 1 ? radius : height - 1;
+    if (rx > BMP_BOX_MAX_RADIUS || ry > BMP_BOX_MAX_RADIUS) {
+        printf("Error: Box radius must be at most %d.\n", BMP_BOX_MAX_RADIUS);
+        return -1;
+    }
+
+    int ringRows = 2 * ry + 1;
+    size_t rowBytes = (size_t)width * channels;
+    uint32_t *ring = (uint32_t *)malloc((size_t)ringRows * rowBytes * sizeof(uint32_t));
+    uint32_t *column = (uint32_t *)calloc(rowBytes, sizeof(uint32_t));
+    uint32_t *cols = (uint32_t *)malloc((size_t)width * sizeof(uint32_t));
+    if (!ring || !column || !cols) {
+        printf("Error: Memory allocation for box filter failed.\n");
+        free(ring);
+        free(column);
+        free(cols);
+        return -1;
+    }
+
+    // Number of columns inside the window of each x
+    for (int x = 0; x < width; x++) {
+        int lo = x - rx > 0 ? x - rx : 0;
+        int hi = x + rx < width - 1 ? x + rx : width - 1;
+        cols[x] = (uint32_t)(hi - lo + 1);
+    }
+
+    for (int y = 0; y < ry; y++) {
+        bmp_boxLoadRow(data + (size_t)y * stride, ring + (size_t)y * rowBytes, column, width, channels, rx);
+    }
+    for (int y = 0; y < height; y++) {
+        int bottom = y + ry;
+        if (bottom < height) {
+            // Row y - ry - 1 shares the slot and leaves the window
+            if (y - ry - 1 >= 0) {
+                const uint32_t *old = ring + (size_t)(bottom % ringRows) * rowBytes;
+                for (size_t b = 0; b < rowBytes; b++) column[b] -= old[b];
+            }
+            bmp_boxLoadRow(data + (size_t)bottom * stride, ring + (size_t)(bottom % ringRows) * rowBytes,
+                           column, width, channels, rx);
+        } else if (y - ry - 1 >= 0) {
+            const uint32_t *old = ring + (size_t)((y - ry - 1) % ringRows) * rowBytes;
+            for (size_t b = 0; b < rowBytes; b++) column[b] -= old[b];
+        }
+
+        int top = y - ry > 0 ? y - ry : 0;
+        uint32_t rows = (uint32_t)((bottom < height ? bottom : height - 1) - top + 1);
+        uint8_t *out = data + (size_t)y * stride;
+        for (int x = 0; x < width; x++) {
+            uint32_t count = rows * cols[x];
+            for (int c = 0; c < channels; c++) {
+                out[x * channels + c] = (uint8_t)((column[x * channels + c] + count / 2) / count);
+            }
+        }
+    }
+
+    free(ring);
+    free(column);
+    free(cols);
+    return 0;
+}
+
+/* Recursive Gaussian */
+
+/*
+ * Third-order recursive Gaussian (Young and van Vliet): a causal and an
+ * anticausal pass whose cascade approximates a Gaussian with a handful of
+ * multiply-adds per pixel whatever the sigma. The poles are those of van Vliet,
+ * Young and Verbeek (1998), scaled so that the variance is exactly sigma^2,
+ * which fits the Gaussian about three times better than the 1995 polynomial
+ * coefficients. The edges are extended with the edge value: the causal pass
+ * starts in its steady state for the first value, and the anticausal pass
+ * from the Triggs - Sdika boundary values, which account for the causal
+ * response continuing past the last pixel. The recursions run in double: for
+ * large sigma the poles come so close to 1 that float drifts by several levels.
+ *
+ * Columns are filtered first, in strips of BMP_GAUSS_BATCH bytes whose lanes
+ * are independent and vectorize, and rounded back into the image; rows are
+ * then filtered one at a time. Scratch is one strip of height doubles and one
+ * row of doubles per thread, never a copy of the image.
+ */
+#define BMP_GAUSS_BATCH 64
+
+typedef struct {
+    double b;               ///< Gain of the new input
+    double a1, a2, a3;      ///< Feedback of the last three outputs
+    double m[3][3];         ///< Anticausal outputs at the last pixel and the two after it, from the last three causal ones
+} t_bmp_gauss;
+
+/* Variance of the forward-backward cascade for poles scaled by 1 / q (each pole adds 2 p / (1 - p)^2) */
+static double bmp_gaussVariance(double q, double *a1, double *a2, double *a3) {
+    // Poles for sigma 2 (L-infinity fit): 1.41650 +/- 1.00829i and 1.86543, as 1 / p
+    double r = pow(1.41650 * 1.41650 + 1.00829 * 1.00829, -0.5 / q);
+    double phi = atan2(1.00829, 1.41650) / q;
+    double re = r * cos(phi), im = r * sin(phi);
+    double p3 = pow(1.86543, -1 / q);
+
+    // p / (1 - p)^2 for the complex pole, doubled for its conjugate
+    double ur = 1 - re, ui = -im;
+    double sr = ur * ur - ui * ui, si = 2 * ur * ui;
+    double pairVar = 2 * (re * sr + im * si) / (sr * sr + si * si);
+    double realVar = p3 / ((1 - p3) * (1 - p3));
+
+    // 1 - a1 z^-1 - a2 z^-2 - a3 z^-3 = (1 - p z^-1)(1 - conj(p) z^-1)(1 - p3 z^-1)
+    *a1 = 2 * re + p3;
+    *a2 = -(r * r + 2 * re * p3);
+    *a3 = r * r * p3;
+    return 2 * (pairVar + realVar);
+}
+
+static void bmp_gaussCoefficients(t_bmp_gauss *g, double sigma) {
+    // The variance grows with q: bisect for sigma^2
+    double a1, a2, a3, lo = 0.1, hi = 4 * sigma + 10;
+    for (int i = 0; i < 100; i++) {
+        double q = 0.5 * (lo + hi);
+        if (bmp_gaussVariance(q, &a1, &a2, &a3) < sigma * sigma) lo = q;
+        else hi = q;
+    }
+    bmp_gaussVariance(0.5 * (lo + hi), &a1, &a2, &a3);
+    double b = 1 - (a1 + a2 + a3);
+    g->a1 = a1;
+    g->a2 = a2;
+    g->a3 = a3;
+    g->b = b;
+
+    // Triggs and Sdika, "Boundary conditions for Young - van Vliet recursive filtering" (2006),
+    // applied to the deviations of the causal outputs from the edge value
+    double scale = b / ((1 + a1 - a2 + a3) * (1 - a1 - a2 - a3) * (1 + a2 + (a1 - a3) * a3));
+    double m[3][3] = {
+        {-a3 * a1 + 1 - a3 * a3 - a2, (a3 + a1) * (a2 + a3 * a1), a3 * (a1 + a3 * a2)},
+        {a1 + a3 * a2, -(a2 - 1) * (a2 + a3 * a1), -a3 * (a3 * a1 + a3 * a3 + a2 - 1)},
+        {a3 * a1 + a2 + a1 * a1 - a2 * a2, a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3,
+         a3 * (a1 + a3 * a2)},
+    };
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) g->m[i][j] = (scale * m[i][j]);
+    }
+}
+
+/* Anticausal outputs at the last pixel and the two after it; w are the last three causal outputs, u the last input */
+static inline void bmp_gaussBoundary(const t_bmp_gauss *g, double u, double w1, double w2, double w3,
+                                     double *y1, double *y2, double *y3) {
+    double d1 = w1 - u, d2 = w2 - u, d3 = w3 - u;
+    *y1 = u + g->m[0][0] * d1 + g->m[0][1] * d2 + g->m[0][2] * d3;
+    *y2 = u + g->m[1][0] * d1 + g->m[1][1] * d2 + g->m[1][2] * d3;
+    *y3 = u + g->m[2][0] * d1 + g->m[2][1] * d2 + g->m[2][2] * d3;
+}
+
+/* Both passes along one row, the channels side by side, rounded back in place */
+static void bmp_gaussRow(const t_bmp_gauss *g, uint8_t *row, double *line, int width, int channels) {
+    for (int c = 0; c < channels; c++) {
+        double w1 = row[c], w2 = w1, w3 = w1;
+        for (int x = 0; x < width; x++) {
+            double w = g->b * row[x * channels + c] + g->a1 * w1 + g->a2 * w2 + g->a3 * w3;
+            line[x * channels + c] = w;
+            w3 = w2;
+            w2 = w1;
+            w1 = w;
+        }
+        double y1, y2, y3;
+        bmp_gaussBoundary(g, row[(width - 1) * channels + c], w1, w2, w3, &y1, &y2, &y3);
+        line[(width - 1) * channels + c] = y1;
+        for (int x = width - 2; x >= 0; x--) {
+            double y = g->b * line[x * channels + c] + g->a1 * y1 + g->a2 * y2 + g->a3 * y3;
+            line[x * channels + c] = y;
+            y3 = y2;
+            y2 = y1;
+            y1 = y;
+        }
+    }
+    for (size_t b = 0; b < (size_t)width * channels; b++) {
+        row[b] = bmp_convRound((float)line[b]);
+    }
+}
+
+/* Both passes down and up a strip of lanes bytes of every row, through height x BMP_GAUSS_BATCH doubles */
+static void bmp_gaussColumns(const t_bmp_gauss *g, uint8_t *data, size_t stride, int height, int lanes,
+                             double *strip) {
+    double s1[BMP_GAUSS_BATCH], s2[BMP_GAUSS_BATCH], s3[BMP_GAUSS_BATCH], last[BMP_GAUSS_BATCH];
+    double b = g->b, a1 = g->a1, a2 = g->a2, a3 = g->a3;
+    const uint8_t *bottom = data + (size_t)(height - 1) * stride;
+
+    for (int j = 0; j < lanes; j++) {
+        s1[j] = s2[j] = s3[j] = data[j];
+        last[j] = bottom[j];
+    }
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = data + (size_t)y * stride;
+        double *acc = strip + (size_t)y * BMP_GAUSS_BATCH;
+        for (int j = 0; j < lanes; j++) {
+            double w = b * row[j] + a1 * s1[j] + a2 * s2[j] + a3 * s3[j];
+            acc[j] = w;
+            s3[j] = s2[j];
+            s2[j] = s1[j];
+            s1[j] = w;
+        }
+    }
+
+    // The sums are rounded in a second loop so the recurrence loop stays branch-free and vectorizes
+    double *accBottom = strip + (size_t)(height - 1) * BMP_GAUSS_BATCH;
+    for (int j = 0; j < lanes; j++) {
+        bmp_gaussBoundary(g, last[j], s1[j], s2[j], s3[j], &s1[j], &s2[j], &s3[j]);
+        accBottom[j] = s1[j];
+    }
+    for (int y = height - 1; y >= 0; y--) {
+        double *acc = strip + (size_t)y * BMP_GAUSS_BATCH;
+        uint8_t *out = data + (size_t)y * stride;
+        if (y < height - 1) {
+            for (int j = 0; j < lanes; j++) {
+                double v = b * acc[j] + a1 * s1[j] + a2 * s2[j] + a3 * s3[j];
+                acc[j] = v;
+                s3[j] = s2[j];
+                s2[j] = s1[j];
+                s1[j] = v;
+            }
+        }
+        for (int j = 0; j < lanes; j++) {
+            out[j] = bmp_convRound((float)acc[j]);
+        }
+    }
+}
+
+int bmp_gaussianPlane(uint8_t *data, size_t stride, int width, int height, int channels, float sigma) {
+    if (!(sigma > 0) || width <= 0 || height <= 0) return 0;
+
+    if (sigma < BMP_GAUSS_IIR_MIN_SIGMA) {
+        float taps[2 * (int)(3 * BMP_GAUSS_IIR_MIN_SIGMA) + 1];
+        int radius = (int)ceilf(3 * sigma);
+        float total = 0;
+        for (int i = -radius; i <= radius; i++) {
+            taps[i + radius] = expf(-(float)(i * i) / (2 * sigma * sigma));
+            total += taps[i + radius];
+        }
+        for (int i = 0; i <= 2 * radius; i++) taps[i] /= total;
+
+        t_bmp_kernel kernel;
+        if (bmp_kernelSeparable(&kernel, taps, taps, 2 * radius + 1) != 0) return -1;
+        int result = bmp_convPlaneBorder(&kernel, data, (ptrdiff_t)stride, width, height, channels,
+                                         BMP_BORDER_CLAMP, 0);
+        bmp_kernelRelease(&kernel);
+        return result;
+    }
+
+    t_bmp_gauss g;
+    bmp_gaussCoefficients(&g, sigma);
+    size_t rowBytes = (size_t)width * channels;
+    int strips = (int)((rowBytes + BMP_GAUSS_BATCH - 1) / BMP_GAUSS_BATCH);
+    int failed = 0;
+
+    #pragma omp parallel if ((long)width * height >= BMP_CONV_PARALLEL_MIN)
+    {
+        double *strip = (double *)malloc((size_t)height * BMP_GAUSS_BATCH * sizeof(double));
+        double *line = (double *)malloc(rowBytes * sizeof(double));
+        if (!strip || !line) {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        #pragma omp for schedule(static)
+        for (int s = 0; s < strips; s++) {
+            if (!strip) continue;
+            size_t first = (size_t)s * BMP_GAUSS_BATCH;
+            int lanes = rowBytes - first < BMP_GAUSS_BATCH ? (int)(rowBytes - first) : BMP_GAUSS_BATCH;
+            bmp_gaussColumns(&g, data + first, stride, height, lanes, strip);
+        }
+
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; y++) {
+            if (!line) continue;
+            bmp_gaussRow(&g, data + (size_t)y * stride, line, width, channels);
+        }
+        free(strip);
+        free(line);
+    }
+
+    if (failed) {
+        printf("Error: Memory allocation for Gaussian blur failed.\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * bmp_conv.h
+ * Header file for the convolution engine shared by the 8-bit, 24-bit and streaming filters
+ *
+ * A kernel is prepared once (copied, and checked for rank-1 separability),
+ * then applied one output row at a time from the kernelSize input rows it
+ * reaches. Pixels are bytes with 1 or 3 interleaved channels; every channel is
+ * filtered the same way.
+ */
+
+#ifndef BMP_CONV_H
+#define BMP_CONV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BMP_CONV_MAX_KERNEL 63  ///< Largest non-separable kernel filtered directly (larger ones go through FFT tiles)
+#define BMP_CONV_INT_MAX_SIZE 15 ///< Largest kernel tried for the integer path
+#define BMP_CONV_PARALLEL_MIN (1 << 16) ///< Pixels below which planes are filtered on one thread
+#define BMP_BOX_MAX_RADIUS 2047 ///< Largest box radius (a 4095 x 4095 sum of bytes fits 32 bits)
+#define BMP_GAUSS_IIR_MIN_SIGMA 3.0f ///< Smallest sigma for the recursive Gaussian (a direct kernel is used below)
+
+/* Border modes: what the kernel sees outside the image */
+#define BMP_BORDER_CONSTANT 0  ///< A constant value (0 gives zero padding)
+#define BMP_BORDER_CLAMP    1  ///< The nearest edge pixel is repeated
+#define BMP_BORDER_MIRROR   2  ///< Reflection about the edge pixel, which is not repeated (cba|abc)
+#define BMP_BORDER_WRAP     3  ///< The image repeats periodically
+
+/**
+ * Kernel prepared for bmp_convRow
+ */
+typedef struct {
+    int size;            ///< Kernel size (odd)
+    float *taps;         ///< size * size coefficients, row by row
+    int separable;       ///< 1 when taps == column x row (rank 1)
+    float *rowTaps;      ///< Horizontal factor (size values) when separable
+    float *colTaps;      ///< Vertical factor (size values) when separable
+    int divisor;         ///< Common denominator D of the taps, 0 when they are not exact fractions
+    int16_t *intTaps;    ///< taps * D as integers when divisor is set
+} t_bmp_kernel;
+
+/**
+ * Copies a square kernel and detects whether it is separable, and whether its
+ * taps are exact fractions n / D (box, binomial, Sobel...) that can run in
+ * integer arithmetic with exact rounding
+ * Kernel to fill, kernel rows, kernel size (odd)
+ * 0 on success, -1 on failure
+ */
+int bmp_kernelPrepare(t_bmp_kernel *kernel, float **taps, int size);
+
+/**
+ * Builds the kernel column x row from its two 1-D factors
+ * Kernel to fill, horizontal factor, vertical factor, size of both (odd)
+ * 0 on success, -1 on failure
+ */
+int bmp_kernelSeparable(t_bmp_kernel *kernel, const float *rowTaps, const float *colTaps, int size);
+
+/**
+ * Frees the memory held by a prepared kernel
+ */
+void bmp_kernelRelease(t_bmp_kernel *kernel);
+
+/**
+ * Number of floats of scratch bmp_convRow needs for a row of the given width
+ * Prepared kernel, width in pixels, channels
+ */
+size_t bmp_convScratchSize(const t_bmp_kernel *kernel, int width, int channels);
+
+/**
+ * Filters pixels x0 to x1 - 1 of one output row
+ * rows[i] is the input row under kernel row i (NULL when it lies outside the
+ * image); taps left or right of the image are skipped as well, i.e. the image
+ * is zero padded. Results are rounded to nearest and clamped to 0..255.
+ * Prepared kernel, input rows, output row, width in pixels, channels (1 or 3),
+ * first and end pixel, scratch of bmp_convScratchSize floats
+ */
+void bmp_convRow(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                 int width, int channels, int x0, int x1, float *scratch);
+
+/**
+ * Filters a whole output row from padded input rows: rows[i][b] must be valid
+ * for b in [-(size / 2) * channels, (width + size / 2) * channels), so no tap
+ * is ever clipped
+ * Prepared kernel, padded input rows, output row, width in pixels, channels,
+ * scratch of bmp_convScratchSize floats
+ */
+void bmp_convRowPadded(const t_bmp_kernel *kernel, const uint8_t *const *rows, uint8_t *out,
+                       int width, int channels, float *scratch);
+
+/**
+ * Filters rows y0 to y1 - 1, pixels x0 to x1 - 1, of a plane in place
+ * Kernel row i covers plane row y - size / 2 + i; rows outside the plane are
+ * skipped like in bmp_convRow. Only a few rows per thread are copied.
+ * Non-separable kernels of 17 taps and more go through bmp_fftConvPlane
+ * when its cost estimate is lower, and always above BMP_CONV_MAX_KERNEL taps
+ * (results may then differ by one level).
+ * Prepared kernel, first row, bytes between rows, width, height, channels (1 or 3),
+ * row range, pixel range
+ * 0 on success, -1 on failure (the plane may then be partly filtered)
+ */
+int bmp_convPlane(const t_bmp_kernel *kernel, uint8_t *data, ptrdiff_t stride, int width, int height,
+                  int channels, int y0, int y1, int x0, int x1);
+
+/**
+ * Filters every pixel of a plane in place, with the given border mode
+ * Rows are copied once into padded ring rows; the filtering itself has no
+ * bounds checks. Scratch is about 3 * size / 2 padded rows per thread.
+ * Prepared kernel, first row, bytes between rows, width, height, channels,
+ * BMP_BORDER_* mode, value for BMP_BORDER_CONSTANT
+ * 0 on success, -1 on failure
+ */
+int bmp_convPlaneBorder(const t_bmp_kernel *kernel, uint8_t *data, ptrdiff_t stride, int width, int height,
+                        int channels, int mode, uint8_t value);
+
+/**
+ * Replaces every pixel by the mean of the (2 * radius + 1)^2 window around it, in place
+ * Only pixels inside the image are averaged, and the mean is rounded to nearest.
+ * Cost per pixel does not depend on the radius (running sums in both directions).
+ * First row, bytes between rows, width, height, channels (1 or 3), radius
+ * 0 on success, -1 on failure (nothing is filtered when the radius, once
+ * limited to the image, is above BMP_BOX_MAX_RADIUS)
+ */
+int bmp_boxFilterPlane(uint8_t *data, size_t stride, int width, int height, int channels, int radius);
+
+/**
+ * Gaussian blur of standard deviation sigma, in place, by a recursive (IIR) filter
+ * Cost per pixel does not depend on sigma (Young - van Vliet third-order filter
+ * along the columns, then along the rows). Below BMP_GAUSS_IIR_MIN_SIGMA, where
+ * the recursion is a poor fit, a separable kernel of radius 3 sigma is used.
+ * Outside the image the edge pixel is repeated. Results stay within two levels
+ * of an exact Gaussian with the same edges. Scratch per thread is
+ * 64 doubles per image row plus one row of doubles, not a copy of the plane.
+ * First row, bytes between rows, width, height, channels (1 or 3), sigma
+ * 0 on success, -1 on failure
+ */
+int bmp_gaussianPlane(uint8_t *data, size_t stride, int width, int height, int channels, float sigma);
+
+#endif // BMP_CONV_H
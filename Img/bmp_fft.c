@@ -0,0 +1,301 @@
+/**
+ * Implementation of the FFT and of overlap-save convolution
+ *
+ * The plane is processed in bands of B = tileSize - kernelSize + 1 output
+ * rows. A band buffer keeps the original bytes of the tileSize rows the band
+ * reaches, so outputs can be written straight back into the image; the last
+ * kernelSize - 1 rows carry over to the next band. Within a band the tiles
+ * (one per B columns and channel) are independent and run in parallel, two
+ * real tiles per complex transform: the kernel is real, so the real and
+ * imaginary parts of the product are the two filtered tiles.
+ */
+
+#include "bmp_fft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Relative cost of one butterfly against one direct multiply-add, measured on x86-64 */
+#define BMP_FFT_BUTTERFLY_COST 4
+
+/* Transform */
+
+int bmp_fftInit(t_bmp_fft *fft, int size) {
+    fft->twiddles = NULL;
+    fft->bitrev = NULL;
+    if (size < 2 || size > BMP_FFT_MAX_SIZE || (size & (size - 1))) {
+        printf("Error: FFT size must be a power of two from 2 to %d.\n", BMP_FFT_MAX_SIZE);
+        return -1;
+    }
+    fft->size = size;
+    fft->twiddles = (float *)malloc((size_t)size * sizeof(float));
+    fft->bitrev = (int *)malloc((size_t)size * sizeof(int));
+    if (!fft->twiddles || !fft->bitrev) {
+        printf("Error: Memory allocation for FFT tables failed.\n");
+        bmp_fftRelease(fft);
+        return -1;
+    }
+
+    const double pi = 3.14159265358979323846;
+    for (int j = 0; j < size / 2; j++) {
+        fft->twiddles[2 * j] = (float)cos(-2 * pi * j / size);
+        fft->twiddles[2 * j + 1] = (float)sin(-2 * pi * j / size);
+    }
+    int bits = 0;
+    while ((1 << bits) < size) bits++;
+    for (int i = 0; i < size; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        fft->bitrev[i] = r;
+    }
+    return 0;
+}
+
+void bmp_fftRelease(t_bmp_fft *fft) {
+    free(fft->twiddles);
+    free(fft->bitrev);
+    fft->twiddles = NULL;
+    fft->bitrev = NULL;
+}
+
+void bmp_fftTransform(const t_bmp_fft *fft, float *data, int inverse) {
+    int size = fft->size;
+    for (int i = 0; i < size; i++) {
+        int j = fft->bitrev[i];
+        if (j > i) {
+            float re = data[2 * i], im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+
+    // Decimation in time: butterflies of span 1, 2, 4... with twiddles every size / (2 * span)
+    float sign = inverse ? -1.0f : 1.0f;
+    for (int span = 1; span < size; span *= 2) {
+        int step = size / (2 * span);
+        for (int start = 0; start < size; start += 2 * span) {
+            float *a = data + 2 * start;
+            float *b = a + 2 * span;
+            for (int j = 0; j < span; j++) {
+                float wr = fft->twiddles[2 * j * step];
+                float wi = sign * fft->twiddles[2 * j * step + 1];
+                float tr = wr * b[2 * j] - wi * b[2 * j + 1];
+                float ti = wr * b[2 * j + 1] + wi * b[2 * j];
+                b[2 * j] = a[2 * j] - tr;
+                b[2 * j + 1] = a[2 * j + 1] - ti;
+                a[2 * j] += tr;
+                a[2 * j + 1] += ti;
+            }
+        }
+    }
+}
+
+/* Transforms the columns of a size x size tile through a contiguous copy of each */
+static void bmp_fftColumns(const t_bmp_fft *fft, float *tile, float *column, int inverse) {
+    int size = fft->size;
+    for (int c = 0; c < size; c++) {
+        for (int r = 0; r < size; r++) {
+            column[2 * r] = tile[2 * ((size_t)r * size + c)];
+            column[2 * r + 1] = tile[2 * ((size_t)r * size + c) + 1];
+        }
+        bmp_fftTransform(fft, column, inverse);
+        for (int r = 0; r < size; r++) {
+            tile[2 * ((size_t)r * size + c)] = column[2 * r];
+            tile[2 * ((size_t)r * size + c) + 1] = column[2 * r + 1];
+        }
+    }
+}
+
+/* Convolution */
+
+int bmp_fftTileSize(const t_bmp_kernel *kernel, int width, int height) {
+    int k = kernel->size;
+    if (kernel->separable || k < BMP_FFT_MIN_KERNEL || width <= 0 || height <= 0) return 0;
+
+    // Direct: k^2 taps per pixel. FFT, per tile and per half complex transform:
+    // N + N forward and N + B inverse 1-D transforms of N / 2 log2 N butterflies, and N^2 products
+    double direct = (double)width * height * k * k;
+    double best = direct;
+    int bestSize = 0;
+    // Above BMP_CONV_MAX_KERNEL the direct filter is never the better choice: any tile the kernel fits will do
+    int force = k > BMP_CONV_MAX_KERNEL;
+    if (force) best = INFINITY;
+    for (int size = 32, bits = 5; size <= BMP_FFT_MAX_SIZE; size *= 2, bits++) {
+        int b = size - k + 1;
+        if (b < (force ? 1 : k)) continue;
+        double tiles = (double)((width + b - 1) / b) * ((height + b - 1) / b);
+        double butterflies = (double)(3 * size + b) * (size / 2) * bits;
+        double cost = tiles * 0.5 * (butterflies * BMP_FFT_BUTTERFLY_COST + 4.0 * size * size);
+        if (cost < best) {
+            best = cost;
+            bestSize = size;
+        }
+        if (b >= width && b >= height) break;  // A larger tile only adds padding
+    }
+    return bestSize;
+}
+
+/* Rounds to nearest and clamps to a byte, as the direct filter does */
+static inline uint8_t bmp_fftRound(float sum) {
+    if (sum <= 0) return 0;
+    if (sum >= 255) return 255;
+    return (uint8_t)(int)(sum + 0.5f);
+}
+
+/* Spectrum of the kernel, placed so that the circular product reads rows and columns y - n + i, scaled by 1 / size^2 */
+static void bmp_fftKernelSpectrum(const t_bmp_fft *fft, const t_bmp_kernel *kernel, float *spectrum, float *column) {
+    int size = fft->size;
+    int k = kernel->size;
+    int n = k / 2;
+    float scale = 1.0f / ((float)size * size);
+    memset(spectrum, 0, 2 * (size_t)size * size * sizeof(float));
+    for (int i = 0; i < k; i++) {
+        int r = (n - i + size) % size;
+        for (int j = 0; j < k; j++) {
+            int c = (n - j + size) % size;
+            spectrum[2 * ((size_t)r * size + c)] = kernel->taps[i * k + j] * scale;
+        }
+    }
+    for (int r = 0; r < size; r++) {
+        bmp_fftTransform(fft, spectrum + 2 * (size_t)r * size, 0);
+    }
+    bmp_fftColumns(fft, spectrum, column, 0);
+}
+
+/* Loads band rows [first, size) with image rows top - n + first..., zero outside the image */
+static void bmp_fftLoadBand(uint8_t *band, int first, int size, const uint8_t *data, ptrdiff_t stride,
+                            size_t rowBytes, int height, int top) {
+    for (int r = first; r < size; r++) {
+        int y = top + r;
+        if (y >= 0 && y < height) memcpy(band + (size_t)r * rowBytes, data + y * stride, rowBytes);
+        else memset(band + (size_t)r * rowBytes, 0, rowBytes);
+    }
+}
+
+int bmp_fftConvPlane(const t_bmp_kernel *kernel, uint8_t *data, ptrdiff_t stride, int width, int height,
+                     int channels, int y0, int y1, int x0, int x1, int tileSize) {
+    int k = kernel->size;
+    int n = k / 2;
+    int size = tileSize;
+    int b = size - k + 1;
+    size_t rowBytes = (size_t)width * channels;
+    int failed = 0;
+    if (y0 < 0) y0 = 0;
+    if (y1 > height) y1 = height;
+    if (x0 < 0) x0 = 0;
+    if (x1 > width) x1 = width;
+    if (y0 >= y1 || x0 >= x1) return 0;
+    if (b < 1) {
+        printf("Error: FFT tile of %d is too small for a %d x %d kernel.\n", size, k, k);
+        return -1;
+    }
+
+    t_bmp_fft fft;
+    if (bmp_fftInit(&fft, size) != 0) return -1;
+    float *spectrum = (float *)malloc(2 * (size_t)size * size * sizeof(float));
+    float *column = (float *)malloc(2 * (size_t)size * sizeof(float));
+    uint8_t *band = (uint8_t *)malloc((size_t)size * rowBytes);
+    if (!spectrum || !column || !band) {
+        printf("Error: Memory allocation for FFT filtering failed.\n");
+        free(spectrum);
+        free(column);
+        free(band);
+        bmp_fftRelease(&fft);
+        return -1;
+    }
+    bmp_fftKernelSpectrum(&fft, kernel, spectrum, column);
+    free(column);
+
+    int tilesX = (x1 - x0 + b - 1) / b;
+    int jobs = tilesX * channels;  // Job j: tile j / channels, channel j % channels
+    int pairs = (jobs + 1) / 2;
+
+    #pragma omp parallel if ((long)(x1 - x0) * (y1 - y0) >= BMP_CONV_PARALLEL_MIN)
+    {
+        float *tile = (float *)malloc(2 * (size_t)size * size * sizeof(float));
+        float *line = (float *)malloc(2 * (size_t)size * sizeof(float));
+        if (!tile || !line) {
+            #pragma omp atomic write
+            failed = 1;
+        }
+        #pragma omp barrier
+        int ok;
+        #pragma omp atomic read
+        ok = failed;
+        ok = !ok;
+
+        for (int y = y0; ok && y < y1; y += b) {
+            // Band rows are image rows y - n .. y - n + size - 1; the last k - 1 carry over
+            #pragma omp single
+            {
+                if (y == y0) {
+                    bmp_fftLoadBand(band, 0, size, data, stride, rowBytes, height, y - n);
+                } else {
+                    memmove(band, band + (size_t)b * rowBytes, (size_t)(k - 1) * rowBytes);
+                    bmp_fftLoadBand(band, k - 1, size, data, stride, rowBytes, height, y - n);
+                }
+            }
+
+            #pragma omp for schedule(dynamic)
+            for (int p = 0; p < pairs; p++) {
+                // Real part from job 2p, imaginary part from job 2p + 1
+                for (int half = 0; half < 2; half++) {
+                    int job = 2 * p + half;
+                    int c = job % channels;
+                    int left = x0 + (job / channels) * b - n;
+                    for (int r = 0; r < size; r++) {
+                        const uint8_t *src = band + (size_t)r * rowBytes;
+                        float *dst = tile + 2 * (size_t)r * size + half;
+                        for (int col = 0; col < size; col++) {
+                            int x = left + col;
+                            dst[2 * col] = (job < jobs && x >= 0 && x < width) ? src[x * channels + c] : 0;
+                        }
+                    }
+                }
+
+                for (int r = 0; r < size; r++) {
+                    bmp_fftTransform(&fft, tile + 2 * (size_t)r * size, 0);
+                }
+                bmp_fftColumns(&fft, tile, line, 0);
+                for (size_t i = 0; i < (size_t)size * size; i++) {
+                    float re = tile[2 * i] * spectrum[2 * i] - tile[2 * i + 1] * spectrum[2 * i + 1];
+                    float im = tile[2 * i] * spectrum[2 * i + 1] + tile[2 * i + 1] * spectrum[2 * i];
+                    tile[2 * i] = re;
+                    tile[2 * i + 1] = im;
+                }
+                // Inverse columns first, so only the b rows that are kept need the row transform
+                bmp_fftColumns(&fft, tile, line, 1);
+                for (int r = n; r < n + b && y + r - n < y1; r++) {
+                    float *src = tile + 2 * (size_t)r * size;
+                    bmp_fftTransform(&fft, src, 1);
+                    uint8_t *out = data + (y + r - n) * stride;
+                    for (int half = 0; half < 2 && 2 * p + half < jobs; half++) {
+                        int job = 2 * p + half;
+                        int c = job % channels;
+                        int first = x0 + (job / channels) * b;
+                        int end = first + b < x1 ? first + b : x1;
+                        for (int x = first; x < end; x++) {
+                            out[x * channels + c] = bmp_fftRound(src[2 * (x - first + n) + half]);
+                        }
+                    }
+                }
+            }
+        }
+        free(tile);
+        free(line);
+    }
+
+    free(spectrum);
+    free(band);
+    bmp_fftRelease(&fft);
+    if (failed) {
+        printf("Error: Memory allocation for FFT tiles failed.\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * bmp_fft.h
+ * Header file for the FFT and frequency-domain convolution of large kernels
+ *
+ * A direct k x k filter costs k^2 multiply-adds per pixel; through the FFT the
+ * cost grows only with log k. Planes are cut into overlap-save tiles of a
+ * fixed power-of-two size, so memory stays bounded whatever the image size,
+ * and two real tiles share one complex transform.
+ */
+
+#ifndef BMP_FFT_H
+#define BMP_FFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bmp_conv.h"
+
+#define BMP_FFT_MIN_KERNEL 17    ///< Smallest kernel size worth trying through the FFT
+#define BMP_FFT_MAX_SIZE 512     ///< Largest tile (transform) size
+
+/**
+ * Precomputed tables of a 1-D radix-2 transform
+ */
+typedef struct {
+    int size;          ///< Number of complex points (power of two)
+    float *twiddles;   ///< cos and sin of -2 pi j / size for j < size / 2, interleaved
+    int *bitrev;       ///< Bit-reversed index of every point
+} t_bmp_fft;
+
+/**
+ * Builds the tables of a transform
+ * Tables to fill, size (power of two, 2 to BMP_FFT_MAX_SIZE)
+ * 0 on success, -1 on failure
+ */
+int bmp_fftInit(t_bmp_fft *fft, int size);
+
+/**
+ * Frees the tables
+ */
+void bmp_fftRelease(t_bmp_fft *fft);
+
+/**
+ * In-place complex transform of size points stored as interleaved (re, im) floats
+ * The inverse is not scaled by 1 / size
+ * Tables, data, 0 for forward or 1 for inverse
+ */
+void bmp_fftTransform(const t_bmp_fft *fft, float *data, int inverse);
+
+/**
+ * Tile size at which the FFT filters a plane faster than the direct kernel, 0 when it does not
+ * Only non-separable kernels of at least BMP_FFT_MIN_KERNEL taps qualify; above
+ * BMP_CONV_MAX_KERNEL taps a tile is returned whenever the kernel fits one
+ * Prepared kernel, width and height of the filtered area
+ */
+int bmp_fftTileSize(const t_bmp_kernel *kernel, int width, int height);
+
+/**
+ * Same filtering as bmp_convPlane (zero padding, rows y0 to y1 - 1, pixels
+ * x0 to x1 - 1, in place) through overlap-save FFT tiles
+ * Results may differ from the direct filter by one level where a sum falls
+ * close to a rounding boundary. Memory is one band of tileSize image rows plus
+ * one transform per thread.
+ * Prepared kernel, first row, bytes between rows, width, height, channels (1 or 3),
+ * row range, pixel range, tile size (power of two, larger than the kernel)
+ * 0 on success, -1 on failure
+ */
+int bmp_fftConvPlane(const t_bmp_kernel *kernel, uint8_t *data, ptrdiff_t stride, int width, int height,
+                     int channels, int y0, int y1, int x0, int x1, int tileSize);
+
+#endif // BMP_FFT_H
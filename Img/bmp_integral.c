@@ -0,0 +1,130 @@
+/**
+ * Implementation of summed-area tables
+ *
+ * Construction is split in two parallel phases: every row is turned into its
+ * running sums independently, then the rows are accumulated downwards with
+ * each thread owning a band of columns.
+ */
+
+#include "bmp_integral.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Tables smaller than this are built on one thread */
+#define BMP_INTEGRAL_PARALLEL_MIN (1 << 16)
+
+t_bmp_integral *bmp_integralCreate(const uint8_t *top, ptrdiff_t stride, int width, int height, int channels) {
+    if (!top || width <= 0 || height <= 0 || (channels != 1 && channels != 3)) return NULL;
+
+    t_bmp_integral *integral = (t_bmp_integral *)malloc(sizeof(t_bmp_integral));
+    if (!integral) {
+        printf("Error: Memory allocation for integral image failed.\n");
+        return NULL;
+    }
+    size_t rowEntries = (size_t)(width + 1) * channels;
+    size_t entries = rowEntries * (height + 1);
+    integral->width = width;
+    integral->height = height;
+    integral->channels = channels;
+    integral->sum = (uint64_t *)malloc(entries * sizeof(uint64_t));
+    integral->sqsum = (uint64_t *)malloc(entries * sizeof(uint64_t));
+    if (!integral->sum || !integral->sqsum) {
+        printf("Error: Memory allocation for integral image failed.\n");
+        bmp_integralFree(integral);
+        return NULL;
+    }
+
+    // Row 0 and column 0 are the empty sums
+    memset(integral->sum, 0, rowEntries * sizeof(uint64_t));
+    memset(integral->sqsum, 0, rowEntries * sizeof(uint64_t));
+
+    // Phase 1: running sums along each row
+    #pragma omp parallel for schedule(static) if ((long)width * height >= BMP_INTEGRAL_PARALLEL_MIN)
+    for (int y = 0; y < height; y++) {
+        const uint8_t *src = top + (ptrdiff_t)y * stride;
+        uint64_t *sum = integral->sum + (size_t)(y + 1) * rowEntries;
+        uint64_t *sqsum = integral->sqsum + (size_t)(y + 1) * rowEntries;
+        for (int c = 0; c < channels; c++) {
+            uint64_t s = 0, sq = 0;
+            sum[c] = 0;
+            sqsum[c] = 0;
+            for (int x = 0; x < width; x++) {
+                uint32_t v = src[x * channels + c];
+                s += v;
+                sq += v * v;
+                sum[(x + 1) * channels + c] = s;
+                sqsum[(x + 1) * channels + c] = sq;
+            }
+        }
+    }
+
+    // Phase 2: accumulate downwards, each thread walking all rows of its own band of columns
+    #pragma omp parallel for schedule(static) if ((long)width * height >= BMP_INTEGRAL_PARALLEL_MIN)
+    for (int b = 0; b < (int)rowEntries; b += 64) {
+        size_t end = (size_t)b + 64 < rowEntries ? (size_t)b + 64 : rowEntries;
+        for (int y = 2; y <= height; y++) {
+            uint64_t *sum = integral->sum + (size_t)y * rowEntries;
+            uint64_t *sqsum = integral->sqsum + (size_t)y * rowEntries;
+            for (size_t i = b; i < end; i++) {
+                sum[i] += sum[i - rowEntries];
+                sqsum[i] += sqsum[i - rowEntries];
+            }
+        }
+    }
+    return integral;
+}
+
+void bmp_integralFree(t_bmp_integral *integral) {
+    if (!integral) return;
+    free(integral->sum);
+    free(integral->sqsum);
+    free(integral);
+}
+
+/* Clips a rectangle to the image, returns 0 when nothing is left */
+static int bmp_integralClip(const t_bmp_integral *integral, int *x0, int *y0, int *x1, int *y1) {
+    if (*x0 < 0) *x0 = 0;
+    if (*y0 < 0) *y0 = 0;
+    if (*x1 > integral->width) *x1 = integral->width;
+    if (*y1 > integral->height) *y1 = integral->height;
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+/* Four-corner lookup over table entries [x0, x1) x [y0, y1) */
+static uint64_t bmp_integralLookup(const t_bmp_integral *integral, const uint64_t *table,
+                                   int x0, int y0, int x1, int y1, int channel) {
+    size_t rowEntries = (size_t)(integral->width + 1) * integral->channels;
+    const uint64_t *top = table + (size_t)y0 * rowEntries + channel;
+    const uint64_t *bottom = table + (size_t)y1 * rowEntries + channel;
+    int c = integral->channels;
+    return bottom[x1 * c] - bottom[x0 * c] - top[x1 * c] + top[x0 * c];
+}
+
+uint64_t bmp_integralSum(const t_bmp_integral *integral, int x, int y, int w, int h, int channel) {
+    int x1 = x + w, y1 = y + h;
+    if (!bmp_integralClip(integral, &x, &y, &x1, &y1)) return 0;
+    return bmp_integralLookup(integral, integral->sum, x, y, x1, y1, channel);
+}
+
+double bmp_integralMean(const t_bmp_integral *integral, int x, int y, int w, int h, int channel) {
+    int x1 = x + w, y1 = y + h;
+    if (!bmp_integralClip(integral, &x, &y, &x1, &y1)) return 0;
+    double count = (double)(x1 - x) * (y1 - y);
+    return bmp_integralLookup(integral, integral->sum, x, y, x1, y1, channel) / count;
+}
+
+double bmp_integralVariance(const t_bmp_integral *integral, int x, int y, int w, int h, int channel) {
+    int x1 = x + w, y1 = y + h;
+    if (!bmp_integralClip(integral, &x, &y, &x1, &y1)) return 0;
+    // n * sqsum - sum^2 is exact in 64 bits for windows up to 2^24 pixels, beyond that double is used
+    uint64_t n = (uint64_t)(x1 - x) * (y1 - y);
+    uint64_t sum = bmp_integralLookup(integral, integral->sum, x, y, x1, y1, channel);
+    uint64_t sqsum = bmp_integralLookup(integral, integral->sqsum, x, y, x1, y1, channel);
+    if (n <= (1u << 24)) {
+        return (double)(n * sqsum - sum * sum) / ((double)n * n);
+    }
+    double mean = (double)sum / n;
+    double var = (double)sqsum / n - mean * mean;
+    return var > 0 ? var : 0;
+}
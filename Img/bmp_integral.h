@@ -0,0 +1,57 @@
+/**
+ * bmp_integral.h
+ * Header file for summed-area tables (integral images)
+ *
+ * The table entry at (x, y) holds the sum of all pixels above and left of it,
+ * so the sum, mean and variance of any rectangle take four lookups whatever
+ * its size. Coordinates are image coordinates: x to the right, y downwards
+ * from the top row. 64-bit entries cannot overflow for any BMP size.
+ */
+
+#ifndef BMP_INTEGRAL_H
+#define BMP_INTEGRAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sum and squared-sum tables of a 1- or 3-channel image
+ */
+typedef struct {
+    int width;        ///< Image width (tables have width + 1 columns)
+    int height;       ///< Image height (tables have height + 1 rows)
+    int channels;     ///< Channels per pixel, interleaved in the tables
+    uint64_t *sum;    ///< Sums of the pixel values
+    uint64_t *sqsum;  ///< Sums of the squared pixel values
+} t_bmp_integral;
+
+/**
+ * Builds the tables of a byte image
+ * First (top) row, bytes from one row to the next one down (negative for
+ * bottom-up storage), width, height, channels (1 or 3)
+ * Pointer to new tables, NULL if allocation fails
+ */
+t_bmp_integral *bmp_integralCreate(const uint8_t *top, ptrdiff_t stride, int width, int height, int channels);
+
+/**
+ * Frees the tables
+ */
+void bmp_integralFree(t_bmp_integral *integral);
+
+/**
+ * Sum of one channel over the w x h rectangle whose top-left pixel is (x, y)
+ * The rectangle is clipped to the image
+ */
+uint64_t bmp_integralSum(const t_bmp_integral *integral, int x, int y, int w, int h, int channel);
+
+/**
+ * Mean of one channel over a rectangle (clipped to the image), 0 when it is empty
+ */
+double bmp_integralMean(const t_bmp_integral *integral, int x, int y, int w, int h, int channel);
+
+/**
+ * Variance of one channel over a rectangle (clipped to the image), 0 when it is empty
+ */
+double bmp_integralVariance(const t_bmp_integral *integral, int x, int y, int w, int h, int channel);
+
+#endif // BMP_INTEGRAL_H
@@ -0,0 +1,372 @@
+/**
+ * Implementation of low-level BMP file access
+ *
+ * Uses mmap on POSIX systems and file mapping objects on Windows.
+ */
+
+#include "bmp_io.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Positioned Reads */
+
+int bmp_openRead(const char *filename) {
+#ifdef _WIN32
+    return _open(filename, _O_RDONLY | _O_BINARY);
+#else
+    return open(filename, O_RDONLY);
+#endif
+}
+
+int bmp_readAt(int fd, void *buffer, size_t size, unsigned long long offset) {
+    unsigned char *dst = (unsigned char *)buffer;
+#ifdef _WIN32
+    // No pread on Windows: seek then read, fine since descriptors are not shared across threads
+    if (_lseeki64(fd, (long long)offset, SEEK_SET) < 0) return -1;
+    while (size > 0) {
+        unsigned int chunk = size > 0x40000000 ? 0x40000000 : (unsigned int)size;
+        int got = _read(fd, dst, chunk);
+        if (got <= 0) return -1;
+        dst += got;
+        size -= (size_t)got;
+    }
+#else
+    while (size > 0) {
+        ssize_t got = pread(fd, dst, size, (off_t)offset);
+        if (got <= 0) return -1;
+        dst += got;
+        size -= (size_t)got;
+        offset += (unsigned long long)got;
+    }
+#endif
+    return 0;
+}
+
+void bmp_closeRead(int fd) {
+    if (fd < 0) return;
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+/* Header Probing */
+
+/* Reads a little-endian 32-bit value */
+static unsigned int bmp_read32(const unsigned char *p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+int bmp_probe(const char *filename, t_bmp_probe *info) {
+    int fd = bmp_openRead(filename);
+    if (fd < 0) {
+        printf("Error: Unable to open file %s\n", filename);
+        return -1;
+    }
+
+    unsigned char header[54];
+    int result = bmp_readAt(fd, header, sizeof(header), 0);
+    bmp_closeRead(fd);
+    if (result != 0 || header[0] != 'B' || header[1] != 'M') {
+        printf("Error: %s is not a BMP file.\n", filename);
+        return -1;
+    }
+
+    info->fileSize = bmp_read32(&header[2]);
+    info->offset = bmp_read32(&header[10]);
+    info->width = (int)bmp_read32(&header[18]);
+    info->height = (int)bmp_read32(&header[22]);
+    info->colorDepth = (unsigned int)header[28] | ((unsigned int)header[29] << 8);
+    info->compression = bmp_read32(&header[30]);
+    info->imageSize = bmp_read32(&header[34]);
+    return 0;
+}
+
+void bmp_printProbe(const t_bmp_probe *info) {
+    printf("Image Info:\n");
+    printf("Width: %d\n", info->width);
+    printf("Height: %d\n", info->height);
+    printf("Color Depth: %u-bit\n", info->colorDepth);
+    printf("Data Offset: %u\n", info->offset);
+    printf("Compression: %u\n", info->compression);
+}
+
+/* Memory Mapping */
+
+#ifdef _WIN32
+
+/* Maps size bytes of an open file, growing it if needed for shared views */
+static int bmp_mapHandle(HANDLE file, int mode, size_t size, t_bmp_mapping *map) {
+    DWORD protect = PAGE_READONLY;
+    DWORD access = FILE_MAP_READ;
+    if (mode == BMP_MAP_PRIVATE) {
+        protect = PAGE_WRITECOPY;
+        access = FILE_MAP_COPY;
+    } else if (mode == BMP_MAP_SHARED) {
+        protect = PAGE_READWRITE;
+        access = FILE_MAP_WRITE;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, protect,
+                                        (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+    if (!mapping) return -1;
+
+    // The view keeps the mapping object alive after its handle is closed
+    void *base = MapViewOfFile(mapping, access, 0, 0, size);
+    CloseHandle(mapping);
+    if (!base) return -1;
+
+    map->base = (unsigned char *)base;
+    map->size = size;
+    return 0;
+}
+
+/* Maps a whole file into memory */
+int bmp_mapFile(const char *filename, int mode, t_bmp_mapping *map) {
+    map->base = NULL;
+    map->size = 0;
+
+    DWORD fileAccess = (mode == BMP_MAP_SHARED) ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+    HANDLE file = CreateFileA(filename, fileAccess, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("Error: Unable to open file %s\n", filename);
+        return -1;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        printf("Error: Unable to map empty file %s\n", filename);
+        CloseHandle(file);
+        return -1;
+    }
+
+    int result = bmp_mapHandle(file, mode, (size_t)size.QuadPart, map);
+    CloseHandle(file);
+    if (result != 0) {
+        printf("Error: Unable to map file %s\n", filename);
+    }
+    return result;
+}
+
+/* 1 when both paths name the same existing file */
+static int bmp_sameFile(const char *a, const char *b) {
+    BY_HANDLE_FILE_INFORMATION infoA, infoB;
+    DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    HANDLE fileA = CreateFileA(a, 0, share, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE fileB = CreateFileA(b, 0, share, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    int same = fileA != INVALID_HANDLE_VALUE && fileB != INVALID_HANDLE_VALUE &&
+               GetFileInformationByHandle(fileA, &infoA) && GetFileInformationByHandle(fileB, &infoB) &&
+               infoA.dwVolumeSerialNumber == infoB.dwVolumeSerialNumber &&
+               infoA.nFileIndexHigh == infoB.nFileIndexHigh && infoA.nFileIndexLow == infoB.nFileIndexLow;
+    if (fileA != INVALID_HANDLE_VALUE) CloseHandle(fileA);
+    if (fileB != INVALID_HANDLE_VALUE) CloseHandle(fileB);
+    return same;
+}
+
+/* Creates a copy of a file and maps it for in-place editing */
+int bmp_mapCopy(const char *src, const char *dst, t_bmp_mapping *map) {
+    map->base = NULL;
+    map->size = 0;
+
+    // Creating dst would empty src before it is read
+    if (bmp_sameFile(src, dst)) {
+        return bmp_mapFile(src, BMP_MAP_SHARED, map);
+    }
+
+    HANDLE in = CreateFileA(src, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (in == INVALID_HANDLE_VALUE) {
+        printf("Error: Unable to open file %s\n", src);
+        return -1;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(in, &size) || size.QuadPart == 0) {
+        printf("Error: Unable to map empty file %s\n", src);
+        CloseHandle(in);
+        return -1;
+    }
+
+    HANDLE out = CreateFileA(dst, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                             CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (out == INVALID_HANDLE_VALUE) {
+        printf("Error: Unable to create file %s\n", dst);
+        CloseHandle(in);
+        return -1;
+    }
+
+    // Mapping a writable view of the full size reserves the file's space
+    if (bmp_mapHandle(out, BMP_MAP_SHARED, (size_t)size.QuadPart, map) != 0) {
+        printf("Error: Unable to map file %s\n", dst);
+        CloseHandle(in);
+        CloseHandle(out);
+        DeleteFileA(dst);
+        return -1;
+    }
+    CloseHandle(out);
+
+    // Read the source straight into the new file's pages
+    size_t done = 0;
+    while (done < map->size) {
+        DWORD chunk = (map->size - done > 0x40000000) ? 0x40000000 : (DWORD)(map->size - done);
+        DWORD got = 0;
+        if (!ReadFile(in, map->base + done, chunk, &got, NULL) || got == 0) {
+            printf("Error: Failed to copy %s to %s\n", src, dst);
+            CloseHandle(in);
+            bmp_unmapFile(map);
+            DeleteFileA(dst);
+            return -1;
+        }
+        done += got;
+    }
+    CloseHandle(in);
+    return 0;
+}
+
+/* Releases a mapping created by bmp_mapFile or bmp_mapCopy */
+void bmp_unmapFile(t_bmp_mapping *map) {
+    if (!map || !map->base) return;
+    UnmapViewOfFile(map->base);
+    map->base = NULL;
+    map->size = 0;
+}
+
+/* Deletes a copy that turned out unusable, never the source itself */
+void bmp_removeCopy(const char *src, const char *dst) {
+    if (dst && !bmp_sameFile(src, dst)) DeleteFileA(dst);
+}
+
+#else
+
+/* Maps a whole file into memory */
+int bmp_mapFile(const char *filename, int mode, t_bmp_mapping *map) {
+    map->base = NULL;
+    map->size = 0;
+
+    int fd = open(filename, (mode == BMP_MAP_SHARED) ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        printf("Error: Unable to open file %s\n", filename);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("Error: Unable to map empty file %s\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    int prot = (mode == BMP_MAP_READONLY) ? PROT_READ : PROT_READ | PROT_WRITE;
+    int flags = (mode == BMP_MAP_SHARED) ? MAP_SHARED : MAP_PRIVATE;
+    void *base = mmap(NULL, (size_t)st.st_size, prot, flags, fd, 0);
+    // The mapping holds its own reference to the file
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("Error: Unable to map file %s\n", filename);
+        return -1;
+    }
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    map->base = (unsigned char *)base;
+    map->size = (size_t)st.st_size;
+    return 0;
+}
+
+/* Creates a copy of a file and maps it for in-place editing */
+int bmp_mapCopy(const char *src, const char *dst, t_bmp_mapping *map) {
+    map->base = NULL;
+    map->size = 0;
+
+    int in = open(src, O_RDONLY);
+    if (in < 0) {
+        printf("Error: Unable to open file %s\n", src);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(in, &st) != 0 || st.st_size == 0) {
+        printf("Error: Unable to map empty file %s\n", src);
+        close(in);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+
+    // O_TRUNC on src itself would empty it before it is read: edit it in place instead
+    struct stat dstSt;
+    if (stat(dst, &dstSt) == 0 && dstSt.st_dev == st.st_dev && dstSt.st_ino == st.st_ino) {
+        close(in);
+        return bmp_mapFile(src, BMP_MAP_SHARED, map);
+    }
+
+    int out = open(dst, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        printf("Error: Unable to create file %s\n", dst);
+        close(in);
+        return -1;
+    }
+
+    // Reserve the blocks up front; fall back to a sparse file where unsupported
+    if (posix_fallocate(out, 0, (off_t)size) != 0 && ftruncate(out, (off_t)size) != 0) {
+        printf("Error: Unable to allocate %zu bytes for %s\n", size, dst);
+        close(in);
+        close(out);
+        unlink(dst);
+        return -1;
+    }
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+    close(out);
+    if (base == MAP_FAILED) {
+        printf("Error: Unable to map file %s\n", dst);
+        close(in);
+        unlink(dst);
+        return -1;
+    }
+    map->base = (unsigned char *)base;
+    map->size = size;
+
+    // Read the source straight into the new file's pages
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = pread(in, map->base + done, size - done, (off_t)done);
+        if (got <= 0) {
+            printf("Error: Failed to copy %s to %s\n", src, dst);
+            close(in);
+            bmp_unmapFile(map);
+            unlink(dst);
+            return -1;
+        }
+        done += (size_t)got;
+    }
+    close(in);
+    return 0;
+}
+
+/* Releases a mapping created by bmp_mapFile or bmp_mapCopy */
+void bmp_unmapFile(t_bmp_mapping *map) {
+    if (!map || !map->base) return;
+    munmap(map->base, map->size);
+    map->base = NULL;
+    map->size = 0;
+}
+
+/* Deletes a copy that turned out unusable, never the source itself */
+void bmp_removeCopy(const char *src, const char *dst) {
+    struct stat srcSt, dstSt;
+    if (!dst || stat(dst, &dstSt) != 0) return;
+    if (stat(src, &srcSt) == 0 && srcSt.st_dev == dstSt.st_dev && srcSt.st_ino == dstSt.st_ino) return;
+    unlink(dst);
+}
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * bmp_io.h
+ * Header file for low-level BMP file access shared by the 8-bit and 24-bit libraries
+ *
+ * Provides memory-mapped views of image files so pixel data can be used
+ * directly from the page cache instead of being copied into heap buffers.
+ */
+
+#ifndef BMP_IO_H
+#define BMP_IO_H
+
+#include <stddef.h>
+
+/* Mapping modes */
+#define BMP_MAP_READONLY 0  ///< Read-only view, writing to it is an error
+#define BMP_MAP_PRIVATE  1  ///< Copy-on-write view, changes never reach the file
+#define BMP_MAP_SHARED   2  ///< Writable view, changes are written back to the file
+
+/**
+ * Structure describing a mapped file
+ */
+typedef struct {
+    unsigned char *base;  ///< First byte of the file, NULL when nothing is mapped
+    size_t size;          ///< Length of the mapping in bytes
+} t_bmp_mapping;
+
+/**
+ * Metadata read from the first 54 bytes of a BMP file
+ */
+typedef struct {
+    int width;                 ///< Width
+    int height;                ///< Height (negative for top-down images)
+    unsigned int colorDepth;   ///< Bits per pixel
+    unsigned int offset;       ///< Offset of the pixel data
+    unsigned int compression;  ///< Compression (0 for uncompressed)
+    unsigned int fileSize;     ///< File size recorded in the header
+    unsigned int imageSize;    ///< Pixel data size recorded in the header
+} t_bmp_probe;
+
+/**
+ * Opens a file for positioned reads
+ * Path to the file
+ * File descriptor, -1 on failure
+ */
+int bmp_openRead(const char *filename);
+
+/**
+ * Reads exactly size bytes at a given offset without moving a file position
+ * File descriptor from bmp_openRead
+ * Destination buffer
+ * Number of bytes
+ * Offset from the start of the file
+ * 0 on success, -1 on failure or short read
+ */
+int bmp_readAt(int fd, void *buffer, size_t size, unsigned long long offset);
+
+/**
+ * Closes a file opened with bmp_openRead
+ * File descriptor
+ */
+void bmp_closeRead(int fd);
+
+/**
+ * Reads the BMP headers only (a single 54-byte read)
+ * Path to the file
+ * Structure to fill in
+ * 0 on success, -1 if the file cannot be read or is not a BMP
+ */
+int bmp_probe(const char *filename, t_bmp_probe *info);
+
+/**
+ * Prints the metadata returned by bmp_probe
+ * Probed metadata
+ */
+void bmp_printProbe(const t_bmp_probe *info);
+
+/**
+ * Maps a whole file into memory
+ * Path to the file
+ * One of the BMP_MAP_* modes
+ * Mapping to fill in
+ * 0 on success, -1 on failure
+ */
+int bmp_mapFile(const char *filename, int mode, t_bmp_mapping *map);
+
+/**
+ * Creates (or truncates) a file with the size and content of another one and
+ * maps the new file with BMP_MAP_SHARED, ready to be edited in place
+ * When both paths name the same file, the source is mapped with BMP_MAP_SHARED
+ * instead (creating the copy would empty it first). No partial copy is left
+ * behind on failure.
+ * Path to the source file
+ * Path to the file to create
+ * Mapping to fill in
+ * 0 on success, -1 on failure
+ */
+int bmp_mapCopy(const char *src, const char *dst, t_bmp_mapping *map);
+
+/**
+ * Releases a mapping created by bmp_mapFile or bmp_mapCopy
+ * Mapping to release, reset to empty afterwards
+ */
+void bmp_unmapFile(t_bmp_mapping *map);
+
+/**
+ * Deletes a copy made by bmp_mapCopy whose content turned out unusable
+ * Nothing is deleted when dst is NULL or names the same file as src
+ * Path to the source file
+ * Path to the copy
+ */
+void bmp_removeCopy(const char *src, const char *dst);
+
+#endif // BMP_IO_H
@@ -0,0 +1,688 @@
+/**
+ * Implementation of the SIMD pixel kernels
+ *
+ * The vector versions are compiled with per-function target attributes, so the
+ * rest of the library keeps the baseline instruction set. On compilers without
+ * them (or off x86) only the scalar versions exist.
+ */
+
+#include "bmp_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BMP_HAVE_X86_SIMD 1
+#endif
+
+/* Level Selection */
+
+static int detectedLevel = -1;
+static int levelCap = BMP_SIMD_AVX512;
+
+/*
+ * Queries cpuid once. Kernels are first called from inside OpenMP regions, so
+ * the check and the store of the cached level are serialised.
+ */
+static int bmp_simdDetect(void) {
+    int level;
+    #pragma omp critical (bmp_simdDetect)
+    {
+        if (detectedLevel < 0) {
+            int found = BMP_SIMD_SCALAR;
+#ifdef BMP_HAVE_X86_SIMD
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse2")) found = BMP_SIMD_SSE2;
+            if (found == BMP_SIMD_SSE2 && __builtin_cpu_supports("ssse3")) found = BMP_SIMD_SSSE3;
+            if (found == BMP_SIMD_SSSE3 && __builtin_cpu_supports("avx2")) found = BMP_SIMD_AVX2;
+            if (found == BMP_SIMD_AVX2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+                found = BMP_SIMD_AVX512;
+            }
+#endif
+            detectedLevel = found;
+        }
+        level = detectedLevel;
+    }
+    return level;
+}
+
+int bmp_simdLevel(void) {
+    int level = bmp_simdDetect();
+    return level < levelCap ? level : levelCap;
+}
+
+void bmp_simdSetLevel(int level) {
+    levelCap = level;
+}
+
+/* Scalar Kernels */
+
+static void bmp_negativeScalar(uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = 255 - data[i];
+    }
+}
+
+static void bmp_brightnessScalar(uint8_t *data, size_t size, int value) {
+    for (size_t i = 0; i < size; i++) {
+        int temp = data[i] + value;
+        if (temp > 255) temp = 255;
+        if (temp < 0) temp = 0;
+        data[i] = (uint8_t)temp;
+    }
+}
+
+static void bmp_thresholdScalar(uint8_t *data, size_t size, int threshold) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (data[i] > threshold) ? 255 : 0;
+    }
+}
+
+static void bmp_swapRedBlueScalar(uint8_t *dst, const uint8_t *src, int count) {
+    for (int j = 0; j < count; j++) {
+        uint8_t first = src[3 * j];
+        dst[3 * j + 1] = src[3 * j + 1];
+        dst[3 * j]     = src[3 * j + 2];
+        dst[3 * j + 2] = first;
+    }
+}
+
+static void bmp_lumaScalar(uint8_t *dst, const uint8_t *src, int count, int c0, int c1, int c2) {
+    for (int j = 0; j < count; j++) {
+        dst[j] = (uint8_t)((c0 * src[3 * j] + c1 * src[3 * j + 1] + c2 * src[3 * j + 2] + 16384) >> 15);
+    }
+}
+
+/*
+ * Full-range BT.601 YCbCr. Forward weights are in 1/32768, inverse ones in
+ * 1/16384, so every product fits a 16-bit multiply-add.
+ */
+#define BMP_CHROMA_BIAS ((128 << 15) + 16384)
+
+static inline uint8_t bmp_clampByte(int v) {
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static void bmp_toYCbCrScalar(uint8_t *data, int count, unsigned int *hist) {
+    for (int j = 0; j < count; j++, data += 3) {
+        int r = data[0], g = data[1], b = data[2];
+        int y = (9798 * r + 19235 * g + 3735 * b + 16384) >> 15;
+        data[0] = (uint8_t)y;
+        data[1] = bmp_clampByte((-5529 * r - 10855 * g + 16384 * b + BMP_CHROMA_BIAS) >> 15);
+        data[2] = bmp_clampByte((16384 * r - 13720 * g - 2664 * b + BMP_CHROMA_BIAS) >> 15);
+        hist[y]++;
+    }
+}
+
+static void bmp_fromYCbCrScalar(uint8_t *data, int count, const uint8_t *lut) {
+    for (int j = 0; j < count; j++, data += 3) {
+        int y = 16384 * lut[data[0]] + 8192;
+        int cb = data[1] - 128, cr = data[2] - 128;
+        data[0] = bmp_clampByte((y + 22970 * cr) >> 14);
+        data[1] = bmp_clampByte((y - 5638 * cb - 11700 * cr) >> 14);
+        data[2] = bmp_clampByte((y + 29032 * cb) >> 14);
+    }
+}
+
+/*
+ * Weighted sums round exactly: the sum S is clamped to [0, 255 D], then
+ * floor((S + D / 2) / D). A power-of-two D is a shift; any other D up to
+ * 1024 is a multiply by ceil(2^32 / D) keeping the high half, which is exact
+ * for every value below 256 D.
+ */
+static int bmp_divisorShift(int divisor) {
+    if (divisor <= 0 || (divisor & (divisor - 1)) != 0) return -1;
+    int shift = 0;
+    while ((1 << shift) < divisor) shift++;
+    return shift;
+}
+
+static void bmp_weightedSumScalar(uint8_t *dst, const uint8_t *const *src, const int16_t *weights,
+                                  int taps, int count, int divisor) {
+    int shift = bmp_divisorShift(divisor);
+    int32_t max = 255 * divisor;
+    for (int b = 0; b < count; b++) {
+        int32_t sum = 0;
+        for (int t = 0; t < taps; t++) {
+            sum += weights[t] * src[t][b];
+        }
+        if (sum < 0) sum = 0;
+        if (sum > max) sum = max;
+        sum += divisor / 2;
+        dst[b] = (uint8_t)(shift >= 0 ? sum >> shift : sum / divisor);
+    }
+}
+
+#ifdef BMP_HAVE_X86_SIMD
+
+/*
+ * Brightness uses saturating unsigned adds or subtracts of |value| (capped at
+ * 255). Threshold with 0 <= t < 255 uses x > t <=> max(x, t + 1) == x.
+ */
+
+/* Weight pair (w0, w1) as the 16-bit lanes of every 32-bit element */
+#define BMP_PAIR(w0, w1) _mm_set1_epi32((int)(((uint32_t)(uint16_t)(w1) << 16) | (uint16_t)(w0)))
+
+/* SSE2 Kernels */
+
+__attribute__((target("sse2")))
+static void bmp_negativeSSE2(uint8_t *data, size_t size) {
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(v, ones));
+    }
+    bmp_negativeScalar(data + i, size - i);
+}
+
+__attribute__((target("sse2")))
+static void bmp_brightnessSSE2(uint8_t *data, size_t size, int value) {
+    int amount = value < 0 ? -value : value;
+    const __m128i delta = _mm_set1_epi8((char)(amount > 255 ? 255 : amount));
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        v = (value >= 0) ? _mm_adds_epu8(v, delta) : _mm_subs_epu8(v, delta);
+        _mm_storeu_si128((__m128i *)(data + i), v);
+    }
+    bmp_brightnessScalar(data + i, size - i, value);
+}
+
+__attribute__((target("sse2")))
+static void bmp_thresholdSSE2(uint8_t *data, size_t size, int threshold) {
+    if (threshold < 0 || threshold >= 255) {
+        bmp_thresholdScalar(data, size, threshold);
+        return;
+    }
+    const __m128i limit = _mm_set1_epi8((char)(threshold + 1));
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_cmpeq_epi8(_mm_max_epu8(v, limit), v));
+    }
+    bmp_thresholdScalar(data + i, size - i, threshold);
+}
+
+/* Exactly rounded quotient of four int32 sums (see bmp_weightedSumScalar) */
+__attribute__((target("sse2")))
+static inline __m128i bmp_roundDivide(__m128i sum, int divisor, int shift, __m128i magic) {
+    sum = _mm_add_epi32(sum, _mm_set1_epi32(divisor / 2));
+    if (shift >= 0) {
+        // Out-of-range results saturate in the byte packing
+        return _mm_srai_epi32(sum, shift);
+    }
+    const __m128i limit = _mm_set1_epi32(255 * divisor + divisor / 2);
+    sum = _mm_andnot_si128(_mm_srai_epi32(sum, 31), sum);
+    __m128i over = _mm_cmpgt_epi32(sum, limit);
+    sum = _mm_or_si128(_mm_and_si128(over, limit), _mm_andnot_si128(over, sum));
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(sum, magic), 32);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(sum, 32), magic);
+    return _mm_or_si128(even, _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+/* Taps are taken two at a time: (p_a, p_b) 16-bit pairs times (w_a, w_b) with pmaddwd */
+__attribute__((target("sse2")))
+static void bmp_weightedSumSSE2(uint8_t *dst, const uint8_t *const *src, const int16_t *weights,
+                                int taps, int count, int divisor) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i magic = _mm_set1_epi32((int)(((1ULL << 32) + divisor - 1) / divisor));
+    int shift = bmp_divisorShift(divisor);
+    int b = 0;
+    for (; b + 16 <= count; b += 16) {
+        __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        for (int t = 0; t < taps; t += 2) {
+            int second = (t + 1 < taps) ? t + 1 : t;
+            __m128i w = BMP_PAIR(weights[t], (t + 1 < taps) ? weights[t + 1] : 0);
+            __m128i pa = _mm_loadu_si128((const __m128i *)(src[t] + b));
+            __m128i pb = _mm_loadu_si128((const __m128i *)(src[second] + b));
+            __m128i aLo = _mm_unpacklo_epi8(pa, zero), aHi = _mm_unpackhi_epi8(pa, zero);
+            __m128i bLo = _mm_unpacklo_epi8(pb, zero), bHi = _mm_unpackhi_epi8(pb, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), w));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), w));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), w));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), w));
+        }
+        __m128i lo = _mm_packs_epi32(bmp_roundDivide(acc0, divisor, shift, magic),
+                                     bmp_roundDivide(acc1, divisor, shift, magic));
+        __m128i hi = _mm_packs_epi32(bmp_roundDivide(acc2, divisor, shift, magic),
+                                     bmp_roundDivide(acc3, divisor, shift, magic));
+        _mm_storeu_si128((__m128i *)(dst + b), _mm_packus_epi16(lo, hi));
+    }
+    if (b < count) {
+        const uint8_t *tail[BMP_WEIGHTED_MAX_TAPS];
+        for (int t = 0; t < taps; t++) tail[t] = src[t] + b;
+        bmp_weightedSumScalar(dst + b, tail, weights, taps, count - b, divisor);
+    }
+}
+
+/* SSSE3 Kernels */
+
+/* Reverses the five whole pixels of a 16-byte block, byte 15 stays in place */
+#define BMP_SWAP_MASK 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15
+
+__attribute__((target("ssse3")))
+static void bmp_swapRedBlueSSSE3(uint8_t *dst, const uint8_t *src, int count) {
+    const __m128i mask = _mm_setr_epi8(BMP_SWAP_MASK);
+    int j = 0;
+    // 5 pixels per step, the 16-byte load needs one byte past them
+    for (; j + 6 <= count; j += 5) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 3 * j));
+        _mm_storeu_si128((__m128i *)(dst + 3 * j), _mm_shuffle_epi8(v, mask));
+    }
+    bmp_swapRedBlueScalar(dst + 3 * j, src + 3 * j, count - j);
+}
+
+/* Splits 16 packed 3-byte pixels (48 bytes in a, b, c) into one register per byte position */
+__attribute__((target("ssse3")))
+static inline void bmp_deinterleave3(__m128i a, __m128i b, __m128i c, __m128i *p0, __m128i *p1, __m128i *p2) {
+    static const int8_t masks[3][3][16] = {
+        {{0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13}},
+        {{1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14}},
+        {{2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1},
+         {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15}}
+    };
+    __m128i *out[3] = {p0, p1, p2};
+    for (int ch = 0; ch < 3; ch++) {
+        __m128i v = _mm_shuffle_epi8(a, _mm_loadu_si128((const __m128i *)masks[ch][0]));
+        v = _mm_or_si128(v, _mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i *)masks[ch][1])));
+        v = _mm_or_si128(v, _mm_shuffle_epi8(c, _mm_loadu_si128((const __m128i *)masks[ch][2])));
+        *out[ch] = v;
+    }
+}
+
+/* Luma of 8 pixels given as 16-bit lanes, packed into the low 8 bytes */
+__attribute__((target("ssse3")))
+static inline __m128i bmp_luma8(__m128i p0, __m128i p1, __m128i p2, __m128i w01, __m128i w2r) {
+    const __m128i one = _mm_set1_epi16(1);
+    // (p0, p1) pairs times (c0, c1), plus (p2, 1) pairs times (c2, 16384) for the rounding
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(p0, p1), w01),
+                               _mm_madd_epi16(_mm_unpacklo_epi16(p2, one), w2r));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(p0, p1), w01),
+                               _mm_madd_epi16(_mm_unpackhi_epi16(p2, one), w2r));
+    return _mm_packs_epi32(_mm_srli_epi32(lo, 15), _mm_srli_epi32(hi, 15));
+}
+
+__attribute__((target("ssse3")))
+static void bmp_lumaSSSE3(uint8_t *dst, const uint8_t *src, int count, int c0, int c1, int c2) {
+    const __m128i w01 = _mm_set1_epi32((c1 << 16) | c0);
+    const __m128i w2r = _mm_set1_epi32((16384 << 16) | c2);
+    const __m128i zero = _mm_setzero_si128();
+    int j = 0;
+    for (; j + 16 <= count; j += 16) {
+        const uint8_t *in = src + 3 * j;
+        __m128i p0, p1, p2;
+        bmp_deinterleave3(_mm_loadu_si128((const __m128i *)in),
+                          _mm_loadu_si128((const __m128i *)(in + 16)),
+                          _mm_loadu_si128((const __m128i *)(in + 32)), &p0, &p1, &p2);
+        __m128i lo = bmp_luma8(_mm_unpacklo_epi8(p0, zero), _mm_unpacklo_epi8(p1, zero),
+                               _mm_unpacklo_epi8(p2, zero), w01, w2r);
+        __m128i hi = bmp_luma8(_mm_unpackhi_epi8(p0, zero), _mm_unpackhi_epi8(p1, zero),
+                               _mm_unpackhi_epi8(p2, zero), w01, w2r);
+        _mm_storeu_si128((__m128i *)(dst + j), _mm_packus_epi16(lo, hi));
+    }
+    bmp_lumaScalar(dst + j, src + 3 * j, count - j, c0, c1, c2);
+}
+
+/* Inverse of bmp_deinterleave3: packs one register per byte position back into 16 3-byte pixels */
+__attribute__((target("ssse3")))
+static inline void bmp_interleave3(__m128i p0, __m128i p1, __m128i p2, __m128i *a, __m128i *b, __m128i *c) {
+    static const int8_t masks[3][3][16] = {
+        {{0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5},
+         {-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1},
+         {-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1}},
+        {{-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1},
+         {5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10},
+         {-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1}},
+        {{-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1},
+         {-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1},
+         {10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15}}
+    };
+    __m128i *out[3] = {a, b, c};
+    for (int o = 0; o < 3; o++) {
+        __m128i v = _mm_shuffle_epi8(p0, _mm_loadu_si128((const __m128i *)masks[o][0]));
+        v = _mm_or_si128(v, _mm_shuffle_epi8(p1, _mm_loadu_si128((const __m128i *)masks[o][1])));
+        v = _mm_or_si128(v, _mm_shuffle_epi8(p2, _mm_loadu_si128((const __m128i *)masks[o][2])));
+        *out[o] = v;
+    }
+}
+
+/*
+ * (p0 * w0 + p1 * w1 + p2 * w2 + round + bias) >> shift for 16 pixels, where
+ * w01 holds (w0, w1) and w2r holds (w2, round) as 16-bit pairs. The inputs are
+ * 16-bit lanes (lo and hi halves), the result is saturated to bytes.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i bmp_dot3(const __m128i p0[2], const __m128i p1[2], const __m128i p2[2],
+                               __m128i w01, __m128i w2r, __m128i bias, __m128i shift) {
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i half[2];
+    for (int h = 0; h < 2; h++) {
+        __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(p0[h], p1[h]), w01),
+                                   _mm_madd_epi16(_mm_unpacklo_epi16(p2[h], one), w2r));
+        __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(p0[h], p1[h]), w01),
+                                   _mm_madd_epi16(_mm_unpackhi_epi16(p2[h], one), w2r));
+        lo = _mm_sra_epi32(_mm_add_epi32(lo, bias), shift);
+        hi = _mm_sra_epi32(_mm_add_epi32(hi, bias), shift);
+        half[h] = _mm_packs_epi32(lo, hi);
+    }
+    return _mm_packus_epi16(half[0], half[1]);
+}
+
+__attribute__((target("ssse3")))
+static void bmp_toYCbCrSSSE3(uint8_t *data, int count, unsigned int *hist) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i noBias = _mm_setzero_si128();
+    const __m128i chromaBias = _mm_set1_epi32(128 << 15);
+    const __m128i shift = _mm_cvtsi32_si128(15);
+    uint8_t luma[16];
+    int j = 0;
+    for (; j + 16 <= count; j += 16) {
+        uint8_t *px = data + 3 * j;
+        __m128i r, g, b;
+        bmp_deinterleave3(_mm_loadu_si128((const __m128i *)px),
+                          _mm_loadu_si128((const __m128i *)(px + 16)),
+                          _mm_loadu_si128((const __m128i *)(px + 32)), &r, &g, &b);
+        __m128i r16[2] = {_mm_unpacklo_epi8(r, zero), _mm_unpackhi_epi8(r, zero)};
+        __m128i g16[2] = {_mm_unpacklo_epi8(g, zero), _mm_unpackhi_epi8(g, zero)};
+        __m128i b16[2] = {_mm_unpacklo_epi8(b, zero), _mm_unpackhi_epi8(b, zero)};
+        __m128i y = bmp_dot3(r16, g16, b16, BMP_PAIR(9798, 19235), BMP_PAIR(3735, 16384), noBias, shift);
+        __m128i cb = bmp_dot3(r16, g16, b16, BMP_PAIR(-5529, -10855), BMP_PAIR(16384, 16384), chromaBias, shift);
+        __m128i cr = bmp_dot3(r16, g16, b16, BMP_PAIR(16384, -13720), BMP_PAIR(-2664, 16384), chromaBias, shift);
+        __m128i a, m, c;
+        bmp_interleave3(y, cb, cr, &a, &m, &c);
+        _mm_storeu_si128((__m128i *)px, a);
+        _mm_storeu_si128((__m128i *)(px + 16), m);
+        _mm_storeu_si128((__m128i *)(px + 32), c);
+        _mm_storeu_si128((__m128i *)luma, y);
+        for (int k = 0; k < 16; k++) {
+            hist[luma[k]]++;
+        }
+    }
+    bmp_toYCbCrScalar(data + 3 * j, count - j, hist);
+}
+
+__attribute__((target("ssse3")))
+static void bmp_fromYCbCrSSSE3(uint8_t *data, int count, const uint8_t *lut) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i center = _mm_set1_epi16(128);
+    const __m128i noBias = _mm_setzero_si128();
+    const __m128i shift = _mm_cvtsi32_si128(14);
+    int j = 0;
+    for (; j + 16 <= count; j += 16) {
+        uint8_t *px = data + 3 * j;
+        // No byte gather before AVX-512 VBMI, so the luma table is applied in place first
+        for (int k = 0; k < 16; k++) {
+            px[3 * k] = lut[px[3 * k]];
+        }
+        __m128i y, cb, cr;
+        bmp_deinterleave3(_mm_loadu_si128((const __m128i *)px),
+                          _mm_loadu_si128((const __m128i *)(px + 16)),
+                          _mm_loadu_si128((const __m128i *)(px + 32)), &y, &cb, &cr);
+        __m128i y16[2] = {_mm_unpacklo_epi8(y, zero), _mm_unpackhi_epi8(y, zero)};
+        __m128i cb16[2] = {_mm_sub_epi16(_mm_unpacklo_epi8(cb, zero), center),
+                           _mm_sub_epi16(_mm_unpackhi_epi8(cb, zero), center)};
+        __m128i cr16[2] = {_mm_sub_epi16(_mm_unpacklo_epi8(cr, zero), center),
+                           _mm_sub_epi16(_mm_unpackhi_epi8(cr, zero), center)};
+        __m128i r = bmp_dot3(y16, cr16, cb16, BMP_PAIR(16384, 22970), BMP_PAIR(0, 8192), noBias, shift);
+        __m128i g = bmp_dot3(y16, cb16, cr16, BMP_PAIR(16384, -5638), BMP_PAIR(-11700, 8192), noBias, shift);
+        __m128i b = bmp_dot3(y16, cb16, cr16, BMP_PAIR(16384, 29032), BMP_PAIR(0, 8192), noBias, shift);
+        __m128i a, m, c;
+        bmp_interleave3(r, g, b, &a, &m, &c);
+        _mm_storeu_si128((__m128i *)px, a);
+        _mm_storeu_si128((__m128i *)(px + 16), m);
+        _mm_storeu_si128((__m128i *)(px + 32), c);
+    }
+    bmp_fromYCbCrScalar(data + 3 * j, count - j, lut);
+}
+
+/* AVX2 Kernels */
+
+__attribute__((target("avx2")))
+static void bmp_negativeAVX2(uint8_t *data, size_t size) {
+    const __m256i ones = _mm256_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_xor_si256(v, ones));
+    }
+    bmp_negativeSSE2(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static void bmp_brightnessAVX2(uint8_t *data, size_t size, int value) {
+    int amount = value < 0 ? -value : value;
+    const __m256i delta = _mm256_set1_epi8((char)(amount > 255 ? 255 : amount));
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        v = (value >= 0) ? _mm256_adds_epu8(v, delta) : _mm256_subs_epu8(v, delta);
+        _mm256_storeu_si256((__m256i *)(data + i), v);
+    }
+    bmp_brightnessSSE2(data + i, size - i, value);
+}
+
+__attribute__((target("avx2")))
+static void bmp_thresholdAVX2(uint8_t *data, size_t size, int threshold) {
+    if (threshold < 0 || threshold >= 255) {
+        bmp_thresholdScalar(data, size, threshold);
+        return;
+    }
+    const __m256i limit = _mm256_set1_epi8((char)(threshold + 1));
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_cmpeq_epi8(_mm256_max_epu8(v, limit), v));
+    }
+    bmp_thresholdSSE2(data + i, size - i, threshold);
+}
+
+__attribute__((target("avx2")))
+static void bmp_swapRedBlueAVX2(uint8_t *dst, const uint8_t *src, int count) {
+    const __m256i mask = _mm256_setr_epi8(BMP_SWAP_MASK, BMP_SWAP_MASK);
+    int j = 0;
+    // 10 pixels per step: each 128-bit lane starts on a pixel boundary
+    for (; j + 11 <= count; j += 10) {
+        const uint8_t *in = src + 3 * j;
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+            _mm_loadu_si128((const __m128i *)(in + 15)), 1);
+        v = _mm256_shuffle_epi8(v, mask);
+        _mm_storeu_si128((__m128i *)(dst + 3 * j), _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i *)(dst + 3 * j + 15), _mm256_extracti128_si256(v, 1));
+    }
+    bmp_swapRedBlueScalar(dst + 3 * j, src + 3 * j, count - j);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i bmp_roundDivideAVX2(__m256i sum, int divisor, int shift, __m256i magic) {
+    sum = _mm256_add_epi32(sum, _mm256_set1_epi32(divisor / 2));
+    if (shift >= 0) {
+        return _mm256_srai_epi32(sum, shift);
+    }
+    sum = _mm256_max_epi32(sum, _mm256_setzero_si256());
+    sum = _mm256_min_epi32(sum, _mm256_set1_epi32(255 * divisor + divisor / 2));
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(sum, magic), 32);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(sum, 32), magic);
+    return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+/*
+ * 16 outputs per step: widening keeps bytes 0-7 in the low lane and 8-15 in
+ * the high one, and the in-lane unpacks and packs restore that order.
+ */
+__attribute__((target("avx2")))
+static void bmp_weightedSumAVX2(uint8_t *dst, const uint8_t *const *src, const int16_t *weights,
+                                int taps, int count, int divisor) {
+    const __m256i magic = _mm256_set1_epi32((int)(((1ULL << 32) + divisor - 1) / divisor));
+    int shift = bmp_divisorShift(divisor);
+    int b = 0;
+    for (; b + 16 <= count; b += 16) {
+        __m256i accLo = _mm256_setzero_si256(), accHi = _mm256_setzero_si256();
+        for (int t = 0; t < taps; t += 2) {
+            int second = (t + 1 < taps) ? t + 1 : t;
+            __m256i w = _mm256_set1_epi32((int)(((uint32_t)(uint16_t)((t + 1 < taps) ? weights[t + 1] : 0) << 16) |
+                                                (uint16_t)weights[t]));
+            __m256i pa = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src[t] + b)));
+            __m256i pb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src[second] + b)));
+            accLo = _mm256_add_epi32(accLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(pa, pb), w));
+            accHi = _mm256_add_epi32(accHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(pa, pb), w));
+        }
+        __m256i words = _mm256_packs_epi32(bmp_roundDivideAVX2(accLo, divisor, shift, magic),
+                                           bmp_roundDivideAVX2(accHi, divisor, shift, magic));
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128((__m128i *)(dst + b), _mm256_castsi256_si128(bytes));
+    }
+    if (b < count) {
+        const uint8_t *tail[BMP_WEIGHTED_MAX_TAPS];
+        for (int t = 0; t < taps; t++) tail[t] = src[t] + b;
+        bmp_weightedSumScalar(dst + b, tail, weights, taps, count - b, divisor);
+    }
+}
+
+/* AVX-512 Kernels */
+
+__attribute__((target("avx512f,avx512bw")))
+static void bmp_negativeAVX512(uint8_t *data, size_t size) {
+    const __m512i ones = _mm512_set1_epi8((char)0xFF);
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *)(data + i));
+        _mm512_storeu_si512((void *)(data + i), _mm512_xor_si512(v, ones));
+    }
+    // The tail is done with a masked load/store instead of a scalar loop
+    if (i < size) {
+        __mmask64 m = (1ULL << (size - i)) - 1;
+        __m512i v = _mm512_maskz_loadu_epi8(m, data + i);
+        _mm512_mask_storeu_epi8(data + i, m, _mm512_xor_si512(v, ones));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void bmp_brightnessAVX512(uint8_t *data, size_t size, int value) {
+    int amount = value < 0 ? -value : value;
+    const __m512i delta = _mm512_set1_epi8((char)(amount > 255 ? 255 : amount));
+    for (size_t i = 0; i < size; i += 64) {
+        __mmask64 m = (size - i >= 64) ? ~0ULL : (1ULL << (size - i)) - 1;
+        __m512i v = _mm512_maskz_loadu_epi8(m, data + i);
+        v = (value >= 0) ? _mm512_adds_epu8(v, delta) : _mm512_subs_epu8(v, delta);
+        _mm512_mask_storeu_epi8(data + i, m, v);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void bmp_thresholdAVX512(uint8_t *data, size_t size, int threshold) {
+    if (threshold < 0 || threshold >= 255) {
+        bmp_thresholdScalar(data, size, threshold);
+        return;
+    }
+    const __m512i limit = _mm512_set1_epi8((char)threshold);
+    for (size_t i = 0; i < size; i += 64) {
+        __mmask64 m = (size - i >= 64) ? ~0ULL : (1ULL << (size - i)) - 1;
+        __m512i v = _mm512_maskz_loadu_epi8(m, data + i);
+        __mmask64 above = _mm512_cmpgt_epu8_mask(v, limit);
+        _mm512_mask_storeu_epi8(data + i, m, _mm512_movm_epi8(above));
+    }
+}
+
+#endif
+
+/* Dispatch */
+
+void bmp_negativeBytes(uint8_t *data, size_t size) {
+#ifdef BMP_HAVE_X86_SIMD
+    switch (bmp_simdLevel()) {
+        case BMP_SIMD_AVX512: bmp_negativeAVX512(data, size); return;
+        case BMP_SIMD_AVX2:   bmp_negativeAVX2(data, size); return;
+        case BMP_SIMD_SSSE3:
+        case BMP_SIMD_SSE2:   bmp_negativeSSE2(data, size); return;
+        default: break;
+    }
+#endif
+    bmp_negativeScalar(data, size);
+}
+
+void bmp_brightnessBytes(uint8_t *data, size_t size, int value) {
+#ifdef BMP_HAVE_X86_SIMD
+    switch (bmp_simdLevel()) {
+        case BMP_SIMD_AVX512: bmp_brightnessAVX512(data, size, value); return;
+        case BMP_SIMD_AVX2:   bmp_brightnessAVX2(data, size, value); return;
+        case BMP_SIMD_SSSE3:
+        case BMP_SIMD_SSE2:   bmp_brightnessSSE2(data, size, value); return;
+        default: break;
+    }
+#endif
+    bmp_brightnessScalar(data, size, value);
+}
+
+void bmp_thresholdBytes(uint8_t *data, size_t size, int threshold) {
+#ifdef BMP_HAVE_X86_SIMD
+    switch (bmp_simdLevel()) {
+        case BMP_SIMD_AVX512: bmp_thresholdAVX512(data, size, threshold); return;
+        case BMP_SIMD_AVX2:   bmp_thresholdAVX2(data, size, threshold); return;
+        case BMP_SIMD_SSSE3:
+        case BMP_SIMD_SSE2:   bmp_thresholdSSE2(data, size, threshold); return;
+        default: break;
+    }
+#endif
+    bmp_thresholdScalar(data, size, threshold);
+}
+
+void bmp_lumaBytes(uint8_t *dst, const uint8_t *src, int count, int c0, int c1, int c2) {
+#ifdef BMP_HAVE_X86_SIMD
+    if (bmp_simdLevel() >= BMP_SIMD_SSSE3) {
+        bmp_lumaSSSE3(dst, src, count, c0, c1, c2);
+        return;
+    }
+#endif
+    bmp_lumaScalar(dst, src, count, c0, c1, c2);
+}
+
+void bmp_toYCbCr(uint8_t *data, int count, unsigned int *hist) {
+#ifdef BMP_HAVE_X86_SIMD
+    if (bmp_simdLevel() >= BMP_SIMD_SSSE3) {
+        bmp_toYCbCrSSSE3(data, count, hist);
+        return;
+    }
+#endif
+    bmp_toYCbCrScalar(data, count, hist);
+}
+
+void bmp_fromYCbCr(uint8_t *data, int count, const uint8_t *lut) {
+#ifdef BMP_HAVE_X86_SIMD
+    if (bmp_simdLevel() >= BMP_SIMD_SSSE3) {
+        bmp_fromYCbCrSSSE3(data, count, lut);
+        return;
+    }
+#endif
+    bmp_fromYCbCrScalar(data, count, lut);
+}
+
+void bmp_weightedSumBytes(uint8_t *dst, const uint8_t *const *src, const int16_t *weights,
+                          int taps, int count, int divisor) {
+#ifdef BMP_HAVE_X86_SIMD
+    switch (bmp_simdLevel()) {
+        case BMP_SIMD_AVX512:
+        case BMP_SIMD_AVX2:   bmp_weightedSumAVX2(dst, src, weights, taps, count, divisor); return;
+        case BMP_SIMD_SSSE3:
+        case BMP_SIMD_SSE2:   bmp_weightedSumSSE2(dst, src, weights, taps, count, divisor); return;
+        default: break;
+    }
+#endif
+    bmp_weightedSumScalar(dst, src, weights, taps, count, divisor);
+}
+
+void bmp_swapRedBlue(uint8_t *dst, const uint8_t *src, int count) {
+#ifdef BMP_HAVE_X86_SIMD
+    switch (bmp_simdLevel()) {
+        case BMP_SIMD_AVX512:
+        case BMP_SIMD_AVX2:   bmp_swapRedBlueAVX2(dst, src, count); return;
+        case BMP_SIMD_SSSE3:  bmp_swapRedBlueSSSE3(dst, src, count); return;
+        default: break;
+    }
+#endif
+    bmp_swapRedBlueScalar(dst, src, count);
+}
@@ -0,0 +1,91 @@
+/**
+ * bmp_simd.h
+ * Header file for the SIMD pixel kernels shared by the 8-bit and 24-bit libraries
+ *
+ * Every kernel has a scalar version and SSE2 / SSSE3 / AVX2 / AVX-512 versions
+ * where they help. The best version the CPU supports is picked at runtime
+ * through cpuid, so one binary runs at full speed on any x86 generation.
+ */
+
+#ifndef BMP_SIMD_H
+#define BMP_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Instruction set levels, each one implies the previous ones */
+#define BMP_SIMD_SCALAR 0  ///< Portable C only
+#define BMP_SIMD_SSE2   1  ///< SSE2
+#define BMP_SIMD_SSSE3  2  ///< SSSE3 (byte shuffles)
+#define BMP_SIMD_AVX2   3  ///< AVX2
+#define BMP_SIMD_AVX512 4  ///< AVX-512 F + BW
+
+#define BMP_WEIGHTED_MAX_TAPS 256  ///< Most taps bmp_weightedSumBytes accepts
+
+/**
+ * Returns the level used by the kernels (detected on first use)
+ */
+int bmp_simdLevel(void);
+
+/**
+ * Caps the level used by the kernels, e.g. to compare implementations
+ * Highest level allowed (the detected level still applies as an upper bound)
+ */
+void bmp_simdSetLevel(int level);
+
+/**
+ * Inverts bytes: data[i] = 255 - data[i]
+ * Buffer, number of bytes
+ */
+void bmp_negativeBytes(uint8_t *data, size_t size);
+
+/**
+ * Adds a value to bytes with saturation to 0..255
+ * Buffer, number of bytes, value to add (may be negative)
+ */
+void bmp_brightnessBytes(uint8_t *data, size_t size, int value);
+
+/**
+ * Binarizes bytes: data[i] = data[i] > threshold ? 255 : 0
+ * Buffer, number of bytes, threshold
+ */
+void bmp_thresholdBytes(uint8_t *data, size_t size, int threshold);
+
+/**
+ * Swaps the first and third byte of every 3-byte pixel (BGR <-> RGB)
+ * Destination (may equal src), source, number of pixels
+ */
+void bmp_swapRedBlue(uint8_t *dst, const uint8_t *src, int count);
+
+/**
+ * Weighted sum of the three bytes of every pixel, in 1/32768 fixed point:
+ * dst[j] = (c0 * p[0] + c1 * p[1] + c2 * p[2] + 16384) >> 15
+ * Destination (one byte per pixel), 3-byte pixels, number of pixels,
+ * weights of the first, second and third byte (each below 32768, sum 32768)
+ */
+void bmp_lumaBytes(uint8_t *dst, const uint8_t *src, int count, int c0, int c1, int c2);
+
+/**
+ * Converts RGB pixels to full-range BT.601 YCbCr in place and counts the luma
+ * Pixels (red, green, blue bytes become Y, Cb, Cr), number of pixels,
+ * 256-bin histogram the luma values are added to
+ */
+void bmp_toYCbCr(uint8_t *data, int count, unsigned int *hist);
+
+/**
+ * Maps the luma of YCbCr pixels through a table and converts them back to RGB in place
+ * Pixels, number of pixels, 256-entry luma table
+ */
+void bmp_fromYCbCr(uint8_t *data, int count, const uint8_t *lut);
+
+/**
+ * Integer weighted sum of byte runs with exact rounding:
+ * dst[b] = floor((clamp(sum_t weights[t] * src[t][b], 0, 255 D) + D / 2) / D)
+ * Destination, source run of every tap, weights, number of taps (at most
+ * BMP_WEIGHTED_MAX_TAPS), number of bytes, divisor D (a power of two up to
+ * 16384 or any value up to 1024); 255 * sum |weights| must fit 31 bits
+ */
+void bmp_weightedSumBytes(uint8_t *dst, const uint8_t *const *src, const int16_t *weights,
+                          int taps, int count, int divisor);
+
+#endif // BMP_SIMD_H
@@ -0,0 +1,340 @@
+/**
+ * Implementation of strip-streaming BMP processing
+ *
+ * Rows travel through the pipeline one at a time in file order (bottom row
+ * first). Point stages map bytes through a lookup table; filter stages keep a
+ * ring of kernelSize rows and emit row y once row y + kernelSize / 2 arrived.
+ */
+
+#include "bmp_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+/* Job Setup */
+
+/*
+ * Padded file row size of a width x height image read from a header, -1 when
+ * a dimension is 0 or above INT_MAX (rows are filtered in int) or the pixel
+ * array does not fit 32 bits, as for bmp8_checkSize
+ */
+static int bmp_streamCheckSize(unsigned int width, unsigned int height, unsigned int colorDepth,
+                               unsigned int *rowSize) {
+    if (width == 0 || height == 0 || width > INT_MAX || height > INT_MAX) return -1;
+    size_t bytes = ((size_t)width * (colorDepth / 8) + 3) & ~(size_t)3;
+    if (bytes > UINT_MAX / height) return -1;
+    *rowSize = (unsigned int)bytes;
+    return 0;
+}
+
+t_bmp_stream *bmp_streamOpen(const char *src, const char *dst, unsigned int stripHeight) {
+    FILE *in = fopen(src, "rb");
+    if (!in) {
+        printf("Error: Unable to open file %s\n", src);
+        return NULL;
+    }
+
+    unsigned char header[54];
+    if (fread(header, sizeof(unsigned char), 54, in) != 54) {
+        printf("Error: Failed to read BMP header.\n");
+        fclose(in);
+        return NULL;
+    }
+
+    unsigned int width = *(unsigned int *)&header[18];
+    int fileHeight = *(int *)&header[22];
+    unsigned short colorDepth = *(unsigned short *)&header[28];
+    unsigned int dataOffset = *(unsigned int *)&header[10];
+
+    if (colorDepth != 8 && colorDepth != 24) {
+        printf("Error: Streaming supports 8-bit and 24-bit images only (found %d-bit).\n", colorDepth);
+        fclose(in);
+        return NULL;
+    }
+    if (dataOffset < 54) {
+        printf("Error: Invalid pixel data offset.\n");
+        fclose(in);
+        return NULL;
+    }
+    // Filters rely on the bottom-up row order, so top-down files are refused
+    if (fileHeight < 0) {
+        printf("Error: Streaming does not support top-down images.\n");
+        fclose(in);
+        return NULL;
+    }
+    unsigned int height = (unsigned int)fileHeight;
+    unsigned int rowSize;
+    if (bmp_streamCheckSize(width, height, colorDepth, &rowSize) != 0) {
+        printf("Error: Invalid image size %ux%u.\n", width, height);
+        fclose(in);
+        return NULL;
+    }
+
+    t_bmp_stream *stream = (t_bmp_stream *)calloc(1, sizeof(t_bmp_stream));
+    if (!stream) {
+        printf("Error: Memory allocation failed.\n");
+        fclose(in);
+        return NULL;
+    }
+    stream->in = in;
+    stream->width = width;
+    stream->height = height;
+    stream->colorDepth = colorDepth;
+    stream->rowSize = rowSize;
+    stream->stripHeight = stripHeight ? stripHeight : BMP_STREAM_DEFAULT_STRIP;
+    if (stream->stripHeight > height) stream->stripHeight = height;
+
+    stream->inStrip = (unsigned char *)malloc((size_t)stream->stripHeight * stream->rowSize);
+    stream->outStrip = (unsigned char *)malloc((size_t)stream->stripHeight * stream->rowSize);
+    if (!stream->inStrip || !stream->outStrip) {
+        printf("Error: Memory allocation for strip buffers failed.\n");
+        bmp_streamClose(stream);
+        return NULL;
+    }
+
+    stream->out = fopen(dst, "wb");
+    if (!stream->out) {
+        printf("Error: Unable to open file %s for writing.\n", dst);
+        bmp_streamClose(stream);
+        return NULL;
+    }
+
+    // Everything before the pixels (headers, color table) is copied verbatim;
+    // a short write is reported by bmp_streamRun like those of the pixels
+    unsigned char chunk[1024];
+    if (fwrite(header, sizeof(unsigned char), 54, stream->out) != 54) stream->error = 1;
+    for (unsigned int copied = 54; copied < dataOffset; ) {
+        size_t want = dataOffset - copied < sizeof(chunk) ? dataOffset - copied : sizeof(chunk);
+        if (fread(chunk, 1, want, in) != want) {
+            printf("Error: Failed to read BMP header.\n");
+            bmp_streamClose(stream);
+            return NULL;
+        }
+        if (fwrite(chunk, 1, want, stream->out) != want) stream->error = 1;
+        copied += (unsigned int)want;
+    }
+    return stream;
+}
+
+void bmp_streamClose(t_bmp_stream *stream) {
+    if (!stream) return;
+    for (int i = 0; i < stream->numStages; i++) {
+        if (stream->stages[i].isFilter) bmp_kernelRelease(&stream->stages[i].kernel);
+        free(stream->stages[i].scratch);
+        free(stream->stages[i].window);
+        free(stream->stages[i].output);
+    }
+    if (stream->in) fclose(stream->in);
+    if (stream->out) fclose(stream->out);
+    free(stream->inStrip);
+    free(stream->outStrip);
+    free(stream);
+}
+
+/* Pipeline Construction */
+
+/* Returns the point stage at the end of the pipeline, appending one if needed */
+static t_bmp_stage *bmp_streamPointStage(t_bmp_stream *stream) {
+    if (stream->numStages > 0 && !stream->stages[stream->numStages - 1].isFilter) {
+        return &stream->stages[stream->numStages - 1];
+    }
+    if (stream->numStages == BMP_STREAM_MAX_STAGES) {
+        printf("Error: Too many streaming stages.\n");
+        return NULL;
+    }
+
+    t_bmp_stage *stage = &stream->stages[stream->numStages];
+    memset(stage, 0, sizeof(*stage));
+    stage->output = (unsigned char *)malloc(stream->rowSize);
+    if (!stage->output) {
+        printf("Error: Memory allocation for stage row failed.\n");
+        return NULL;
+    }
+    for (int i = 0; i < 256; i++) stage->lut[i] = (unsigned char)i;
+    stream->numStages++;
+    return stage;
+}
+
+int bmp_streamNegative(t_bmp_stream *stream) {
+    t_bmp_stage *stage = bmp_streamPointStage(stream);
+    if (!stage) return -1;
+    // Consecutive point operations fold into one table
+    for (int i = 0; i < 256; i++) stage->lut[i] = 255 - stage->lut[i];
+    return 0;
+}
+
+int bmp_streamBrightness(t_bmp_stream *stream, int value) {
+    t_bmp_stage *stage = bmp_streamPointStage(stream);
+    if (!stage) return -1;
+    for (int i = 0; i < 256; i++) {
+        int temp = stage->lut[i] + value;
+        if (temp > 255) temp = 255;
+        if (temp < 0) temp = 0;
+        stage->lut[i] = (unsigned char)temp;
+    }
+    return 0;
+}
+
+int bmp_streamThreshold(t_bmp_stream *stream, int threshold) {
+    if (stream->colorDepth != 8) {
+        printf("Error: Thresholding is only available for 8-bit images.\n");
+        return -1;
+    }
+    t_bmp_stage *stage = bmp_streamPointStage(stream);
+    if (!stage) return -1;
+    for (int i = 0; i < 256; i++) {
+        stage->lut[i] = (stage->lut[i] > threshold) ? 255 : 0;
+    }
+    return 0;
+}
+
+int bmp_streamFilter(t_bmp_stream *stream, float **kernel, int kernelSize) {
+    if (kernelSize < 1 || kernelSize % 2 == 0 || kernelSize > BMP_STREAM_MAX_KERNEL) {
+        printf("Error: Kernel size must be odd and at most %d.\n", BMP_STREAM_MAX_KERNEL);
+        return -1;
+    }
+    if (stream->numStages == BMP_STREAM_MAX_STAGES) {
+        printf("Error: Too many streaming stages.\n");
+        return -1;
+    }
+
+    t_bmp_stage *stage = &stream->stages[stream->numStages];
+    memset(stage, 0, sizeof(*stage));
+    if (bmp_kernelPrepare(&stage->kernel, kernel, kernelSize) != 0) return -1;
+    stage->isFilter = 1;
+    stage->kernelSize = kernelSize;
+    stage->scratch = (float *)malloc(bmp_convScratchSize(&stage->kernel, stream->width, stream->colorDepth / 8) * sizeof(float));
+    stage->window = (unsigned char *)malloc((size_t)kernelSize * stream->rowSize);
+    stage->output = (unsigned char *)malloc(stream->rowSize);
+    if (!stage->scratch || !stage->window || !stage->output) {
+        printf("Error: Memory allocation for filter stage failed.\n");
+        bmp_kernelRelease(&stage->kernel);
+        free(stage->scratch);
+        free(stage->window);
+        free(stage->output);
+        return -1;
+    }
+    stream->numStages++;
+    return 0;
+}
+
+/* Row Processing */
+
+/* Queues a finished row for writing, flushing the strip when it is full */
+static void bmp_streamSink(t_bmp_stream *stream, const unsigned char *row) {
+    memcpy(stream->outStrip + (size_t)stream->outRows * stream->rowSize, row, stream->rowSize);
+    if (++stream->outRows == stream->stripHeight) {
+        if (fwrite(stream->outStrip, stream->rowSize, stream->outRows, stream->out) != stream->outRows) {
+            stream->error = 1;
+        }
+        stream->outRows = 0;
+    }
+}
+
+/* Returns file row y from a filter window, NULL when y is outside the image */
+static const unsigned char *bmp_streamWindowRow(const t_bmp_stream *stream, const t_bmp_stage *stage, long y) {
+    if (y < 0 || y >= (long)stage->received) return NULL;
+    return stage->window + (size_t)(y % stage->kernelSize) * stream->rowSize;
+}
+
+/*
+ * Filters file row y into stage->output.
+ * 8-bit follows bmp8_applyFilter: rows and columns closer than kernelSize / 2
+ * to the border are copied unchanged.
+ * 24-bit follows bmp24_applyFilter: taps outside the image are skipped, and
+ * kernel rows run top-down in image order, i.e. upwards in file order.
+ */
+static void bmp_streamFilterRow(const t_bmp_stream *stream, t_bmp_stage *stage, long y) {
+    int k = stage->kernelSize;
+    int n = k / 2;
+    int width = (int)stream->width;
+    const uint8_t *rows[BMP_STREAM_MAX_KERNEL];
+
+    memcpy(stage->output, bmp_streamWindowRow(stream, stage, y), stream->rowSize);
+
+    if (stream->colorDepth == 8) {
+        if (y < n || y >= (long)stream->height - n) return;
+        for (int i = 0; i < k; i++) {
+            rows[i] = bmp_streamWindowRow(stream, stage, y - n + i);
+        }
+        bmp_convRow(&stage->kernel, rows, stage->output, width, 1, n, width - n, stage->scratch);
+        return;
+    }
+
+    for (int i = 0; i < k; i++) {
+        rows[i] = bmp_streamWindowRow(stream, stage, y + n - i);
+    }
+    bmp_convRow(&stage->kernel, rows, stage->output, width, 3, 0, width, stage->scratch);
+}
+
+/* Pushes one file row into the given pipeline stage */
+static void bmp_streamPush(t_bmp_stream *stream, int index, const unsigned char *row) {
+    if (index == stream->numStages) {
+        bmp_streamSink(stream, row);
+        return;
+    }
+
+    t_bmp_stage *stage = &stream->stages[index];
+    if (!stage->isFilter) {
+        // 8-bit rows are mapped whole like bmp8_*; 24-bit padding is left alone
+        unsigned int bytes = (stream->colorDepth == 8) ? stream->rowSize : stream->width * 3;
+        memcpy(stage->output, row, stream->rowSize);
+        for (unsigned int i = 0; i < bytes; i++) {
+            stage->output[i] = stage->lut[row[i]];
+        }
+        bmp_streamPush(stream, index + 1, stage->output);
+        return;
+    }
+
+    int n = stage->kernelSize / 2;
+    memcpy(stage->window + (size_t)(stage->received % stage->kernelSize) * stream->rowSize, row, stream->rowSize);
+    stage->received++;
+    if (stage->received > (unsigned int)n) {
+        bmp_streamFilterRow(stream, stage, stage->emitted++);
+        bmp_streamPush(stream, index + 1, stage->output);
+    }
+}
+
+/* Emits the rows still held back by filter halos, from the given stage on */
+static void bmp_streamFlush(t_bmp_stream *stream, int index) {
+    for (; index < stream->numStages; index++) {
+        t_bmp_stage *stage = &stream->stages[index];
+        if (!stage->isFilter) continue;
+        while (stage->emitted < stream->height) {
+            bmp_streamFilterRow(stream, stage, stage->emitted++);
+            bmp_streamPush(stream, index + 1, stage->output);
+        }
+    }
+}
+
+int bmp_streamRun(t_bmp_stream *stream) {
+    if (!stream) return -1;
+
+    for (unsigned int done = 0; done < stream->height; ) {
+        unsigned int rows = stream->height - done;
+        if (rows > stream->stripHeight) rows = stream->stripHeight;
+        if (fread(stream->inStrip, stream->rowSize, rows, stream->in) != rows) {
+            printf("Error: Failed to read image data.\n");
+            return -1;
+        }
+        for (unsigned int i = 0; i < rows; i++) {
+            bmp_streamPush(stream, 0, stream->inStrip + (size_t)i * stream->rowSize);
+        }
+        done += rows;
+    }
+    bmp_streamFlush(stream, 0);
+
+    if (stream->outRows > 0 &&
+        fwrite(stream->outStrip, stream->rowSize, stream->outRows, stream->out) != stream->outRows) {
+        stream->error = 1;
+    }
+    stream->outRows = 0;
+    // Buffered writes only fail once they reach the file
+    if (fflush(stream->out) != 0) stream->error = 1;
+    if (stream->error) {
+        printf("Error: Failed to write image data.\n");
+        return -1;
+    }
+    return 0;
+}
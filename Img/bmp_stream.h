@@ -0,0 +1,75 @@
+/**
+ * bmp_stream.h
+ * Header file for strip-streaming BMP processing
+ *
+ * Processes 8-bit and 24-bit BMP files that do not fit in memory: the input is
+ * read in horizontal strips, every row is pushed through a pipeline of point
+ * operations and convolution filters, and finished rows are written out
+ * immediately. Filters only keep the rows their kernel reaches (the halo), so
+ * peak memory is bounded by the strip height and the kernel sizes, never by
+ * the image height.
+ *
+ * Results match bmp8_* / bmp24_* applied to the fully loaded image, except
+ * for non-separable kernels of BMP_FFT_MIN_KERNEL (17) taps and more: the
+ * loaded-image filters may run those through the FFT, whose output can differ
+ * by one level, while streams always filter directly.
+ */
+
+#ifndef BMP_STREAM_H
+#define BMP_STREAM_H
+
+#include <stdio.h>
+#include "bmp_conv.h"
+
+#define BMP_STREAM_MAX_STAGES 16       ///< Maximum number of pipeline stages
+#define BMP_STREAM_DEFAULT_STRIP 64    ///< Strip height used when 0 is requested
+#define BMP_STREAM_MAX_KERNEL BMP_CONV_MAX_KERNEL ///< Largest supported filter kernel size
+
+/**
+ * One pipeline stage: either a byte lookup table or a convolution filter
+ */
+typedef struct {
+    int isFilter;                  ///< 0 for a point operation, 1 for a filter
+    unsigned char lut[256];        ///< Point operation lookup table
+    t_bmp_kernel kernel;           ///< Prepared filter kernel
+    int kernelSize;                ///< Filter kernel size (odd)
+    float *scratch;                ///< Row scratch for bmp_convRow
+    unsigned char *window;         ///< Ring of kernelSize input rows
+    unsigned char *output;         ///< Row produced by this stage
+    unsigned int received;         ///< Rows pushed into this stage so far
+    unsigned int emitted;          ///< Rows produced by this stage so far
+} t_bmp_stage;
+
+/**
+ * Structure describing a streaming job from one BMP file to another
+ */
+typedef struct {
+    FILE *in;                      ///< Source file, positioned on the pixel data
+    FILE *out;                     ///< Destination file
+    unsigned int width;            ///< Width
+    unsigned int height;           ///< Height
+    unsigned int colorDepth;       ///< Color depth (8 or 24)
+    unsigned int rowSize;          ///< Bytes per file row, padding included
+    unsigned int stripHeight;      ///< Rows read and written per I/O call
+    unsigned char *inStrip;        ///< Input strip buffer
+    unsigned char *outStrip;       ///< Output strip buffer
+    unsigned int outRows;          ///< Rows currently waiting in outStrip
+    int error;                     ///< Set once a write fails
+    int numStages;                 ///< Number of pipeline stages
+    t_bmp_stage stages[BMP_STREAM_MAX_STAGES]; ///< Pipeline stages
+} t_bmp_stream;
+
+/* Job setup */
+t_bmp_stream *bmp_streamOpen(const char *src, const char *dst, unsigned int stripHeight);
+void bmp_streamClose(t_bmp_stream *stream);
+
+/* Pipeline construction, each returns 0 on success and -1 on failure */
+int bmp_streamNegative(t_bmp_stream *stream);
+int bmp_streamBrightness(t_bmp_stream *stream, int value);
+int bmp_streamThreshold(t_bmp_stream *stream, int threshold);
+int bmp_streamFilter(t_bmp_stream *stream, float **kernel, int kernelSize);
+
+/* Runs the pipeline over the whole file, returns 0 on success and -1 on failure */
+int bmp_streamRun(t_bmp_stream *stream);
+
+#endif // BMP_STREAM_H
@@ -22,7 +22,8 @@ int main(int argc, char *argv[]) {
     }
 
     char outputFile[256];
-    t_bmp8 *image = bmp8_loadImage(inputFile);
+    // Only the header is needed here, so map the file instead of reading it
+    t_bmp8 *image = bmp8_mapImage(inputFile, BMP_MAP_READONLY);
 
     if (!image) {
         printf("Failed to load image.\n");
@@ -32,13 +33,14 @@ int main(int argc, char *argv[]) {
     // Show image info
     bmp8_printInfo(image);
 
+    // Point operations edit a mapped copy of the input directly, no load/save round trip
+
     // Create negative version of the image
     strcpy(outputFile, "negative_");
     strcat(outputFile, inputFile);
-    t_bmp8 *negative = bmp8_loadImage(inputFile);
+    t_bmp8 *negative = bmp8_mapCopy(inputFile, outputFile);
     if (negative) {
         bmp8_negative(negative);
-        bmp8_saveImage(outputFile, negative);
         bmp8_free(negative);
         printf("Negative image saved as %s\n", outputFile);
     }
@@ -46,37 +48,35 @@ int main(int argc, char *argv[]) {
     // Increase image brightness by 50 units
     strcpy(outputFile, "bright_");
     strcat(outputFile, inputFile);
-    t_bmp8 *bright = bmp8_loadImage(inputFile);
+    t_bmp8 *bright = bmp8_mapCopy(inputFile, outputFile);
     if (bright) {
         bmp8_brightness(bright, 50);
-        bmp8_saveImage(outputFile, bright);
         bmp8_free(bright);
         printf("Brightened image saved as %s\n", outputFile);
     }
 
-    // Apply binary threshold at value 128
+    // Apply binary threshold at the Otsu level of the histogram
     strcpy(outputFile, "threshold_");
     strcat(outputFile, inputFile);
-    t_bmp8 *threshold = bmp8_loadImage(inputFile);
+    t_bmp8 *threshold = bmp8_mapCopy(inputFile, outputFile);
     if (threshold) {
-        bmp8_threshold(threshold, 128);
-        bmp8_saveImage(outputFile, threshold);
+        int level = bmp8_autoThreshold(threshold, NULL, BMP8_THRESHOLD_OTSU);
         bmp8_free(threshold);
-        printf("Threshold image saved as %s\n", outputFile);
+        printf("Threshold image (level %d) saved as %s\n", level, outputFile);
     }
 
     // Apply histogram equalization to enhance contrast
     strcpy(outputFile, "equalized_");
     strcat(outputFile, inputFile);
-    t_bmp8 *equalized = bmp8_loadImage(inputFile);
+    // The histogram is counted while loading, so the pixels are only swept once more
+    t_bmp8_stats stats;
+    t_bmp8 *equalized = bmp8_loadImageStats(inputFile, &stats);
     if (equalized) {
-        unsigned int *hist = bmp8_computeHistogram(equalized);
-        unsigned int *cdf = bmp8_computeCDF(hist, equalized->width * equalized->height);
+        unsigned int *cdf = bmp8_computeCDF(stats.histogram, equalized->width * equalized->height);
         bmp8_equalize(equalized, cdf);
 
         bmp8_saveImage(outputFile, equalized);
         bmp8_free(equalized);
-        free(hist);
         free(cdf);
         printf("Equalized image saved as %s\n", outputFile);
     }
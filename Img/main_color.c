@@ -10,14 +10,6 @@
 #include <string.h>
 #include <stdio.h>
 
-/* 3x3 box blur kernel for image filtering */
-float box_blur_data[3][3] = {
-    {1.0f/9, 1.0f/9, 1.0f/9},
-    {1.0f/9, 1.0f/9, 1.0f/9},
-    {1.0f/9, 1.0f/9, 1.0f/9}
-};
-float *box_blur[3] = { box_blur_data[0], box_blur_data[1], box_blur_data[2] };
-
 /* Main function for 24-bit BMP image processing */
 int main(int argc, char *argv[]) {
     const char *inputFile;
@@ -30,53 +22,47 @@ int main(int argc, char *argv[]) {
     }
 
     char outputFile[256];
-    t_bmp24 *image = bmp24_loadImage(inputFile);
+    t_bmp_probe info;
 
-    if (!image) {
+    // Only the headers are needed for the info, no need to decode the pixels
+    if (bmp24_probe(inputFile, &info) != 0) {
         printf("Failed to load image.\n");
         return 1;
     }
 
     printf("\nOriginal Color Image Info:\n");
-    bmp24_printInfo(image);
-    bmp24_free(image); // Free initial info image early
+    bmp_printProbe(&info);
 
     // Negative
     strcpy(outputFile, "color_negative_");
     strcat(outputFile, inputFile);
-    t_bmp24 *neg = bmp24_loadImage(inputFile);
-    if (neg) {
-        bmp24_negative(neg);
-        bmp24_saveImage(neg, outputFile);
-        bmp24_free(neg);
-    }
+    bmp24_negativeFile(inputFile, outputFile);
 
     // Grayscale
     strcpy(outputFile, "color_grayscale_");
     strcat(outputFile, inputFile);
-    t_bmp24 *gray = bmp24_loadImage(inputFile);
-    if (gray) {
-        bmp24_grayscale(gray);
-        bmp24_saveImage(gray, outputFile);
-        bmp24_free(gray);
+    // Saved as a real 8-bit image: one byte per pixel instead of three
+    t_bmp24 *color = bmp24_loadImage(inputFile);
+    if (color) {
+        t_bmp8 *gray = bmp24_toBmp8(color, BMP24_LUMA_BT601);
+        bmp24_free(color);
+        if (gray) {
+            bmp8_saveImage(outputFile, gray);
+            bmp8_free(gray);
+        }
     }
 
     // Brightness +50
     strcpy(outputFile, "color_bright_");
     strcat(outputFile, inputFile);
-    t_bmp24 *bright = bmp24_loadImage(inputFile);
-    if (bright) {
-        bmp24_brightness(bright, 50);
-        bmp24_saveImage(bright, outputFile);
-        bmp24_free(bright);
-    }
+    bmp24_brightnessFile(inputFile, outputFile, 50);
 
-    // Box blur
+    // 3x3 box blur, by running sums
     strcpy(outputFile, "color_blur_");
     strcat(outputFile, inputFile);
     t_bmp24 *blur = bmp24_loadImage(inputFile);
     if (blur) {
-        bmp24_applyFilter(blur, box_blur, 3);
+        bmp24_boxFilter(blur, 1);
         bmp24_saveImage(blur, outputFile);
         bmp24_free(blur);
     }
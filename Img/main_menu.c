@@ -28,7 +28,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#ifdef _WIN32
 #include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 #include "bmp8.h"
 #include "bmp24.h"
 
@@ -172,6 +176,8 @@ void printMenu24Bit(void) {
 void createResultFolder(void) {
     #ifdef _WIN32
         mkdir(RESULT_FOLDER);
+    #else
+        mkdir(RESULT_FOLDER, 0755);
     #endif
 }
 
@@ -210,9 +216,14 @@ void process8BitImage(const char* filename, int numOperations) {
     for (int i = 0; i < numOperations; i++) {
         char outputFilename[MAX_FILENAME];
         t_bmp8* processedImage = NULL;
+        t_bmp8_stats stats;
         
-        // Create a copy of the image for processing
-        processedImage = bmp8_loadImage(filename);
+        // Create a copy of the image for processing (equalization and thresholding get their histogram while loading)
+        if (operations[i] == 4 || operations[i] == 5) {
+            processedImage = bmp8_loadImageStats(filename, &stats);
+        } else {
+            processedImage = bmp8_loadImage(filename);
+        }
         if (!processedImage) {
             printf("Error: Failed to load image for operation %d\n", i + 1);
             continue;
@@ -241,19 +252,19 @@ void process8BitImage(const char* filename, int numOperations) {
                 break;
                 
             case 4: // Thresholding
-                bmp8_threshold(processedImage, 128);
-                snprintf(outputFilename, MAX_FILENAME, "%s/threshold_%d_%s", RESULT_FOLDER, i + 1, filename);
-                bmp8_saveImage(outputFilename, processedImage);
-                printf("Saved thresholded image as %s\n", outputFilename);
+                {
+                    int level = bmp8_autoThreshold(processedImage, stats.histogram, BMP8_THRESHOLD_OTSU);
+                    snprintf(outputFilename, MAX_FILENAME, "%s/threshold_%d_%s", RESULT_FOLDER, i + 1, filename);
+                    bmp8_saveImage(outputFilename, processedImage);
+                    printf("Saved thresholded image (Otsu level %d) as %s\n", level, outputFilename);
+                }
                 break;
                 
             case 5: // Histogram Equalization
                 {
-                    unsigned int* hist = bmp8_computeHistogram(processedImage);
                     unsigned int total_pixels = processedImage->width * processedImage->height;
-                    unsigned int* cdf = bmp8_computeCDF(hist, total_pixels);
+                    unsigned int* cdf = bmp8_computeCDF(stats.histogram, total_pixels);
                     bmp8_equalize(processedImage, cdf);
-                    free(hist);
                     free(cdf);
                     snprintf(outputFilename, MAX_FILENAME, "%s/equalized_%d_%s", RESULT_FOLDER, i + 1, filename);
                     bmp8_saveImage(outputFilename, processedImage);
@@ -263,18 +274,8 @@ void process8BitImage(const char* filename, int numOperations) {
                 
             case 6: // Convolution Filter
                 {
-                    float** kernel = (float**)malloc(3 * sizeof(float*));
-                    for (int j = 0; j < 3; j++) {
-                        kernel[j] = (float*)malloc(3 * sizeof(float));
-                        for (int k = 0; k < 3; k++) {
-                            kernel[j][k] = 1.0f/9;
-                        }
-                    }
-                    bmp8_applyFilter(processedImage, kernel, 3);
-                    for (int j = 0; j < 3; j++) {
-                        free(kernel[j]);
-                    }
-                    free(kernel);
+                    // 3 x 3 mean; near the border only the pixels inside the image are averaged
+                    bmp8_boxFilter(processedImage, 1);
                     snprintf(outputFilename, MAX_FILENAME, "%s/filtered_%d_%s", RESULT_FOLDER, i + 1, filename);
                     bmp8_saveImage(outputFilename, processedImage);
                     printf("Saved filtered image as %s\n", outputFilename);
@@ -327,9 +328,9 @@ void process24BitImage(const char* filename, int numOperations) {
         t_bmp24* processedImage = NULL;
         
         // Create a copy of the image for processing
-        processedImage = bmp24_loadImage(filename);
+        processedImage = bmp24_clone(image);
         if (!processedImage) {
-            printf("Error: Failed to load image for operation %d\n", i + 1);
+            printf("Error: Failed to copy image for operation %d\n", i + 1);
             continue;
         }
         
@@ -364,18 +365,8 @@ void process24BitImage(const char* filename, int numOperations) {
                 
             case 5: // Convolution Filter
                 {
-                    float** kernel = (float**)malloc(3 * sizeof(float*));
-                    for (int j = 0; j < 3; j++) {
-                        kernel[j] = (float*)malloc(3 * sizeof(float));
-                        for (int k = 0; k < 3; k++) {
-                            kernel[j][k] = 1.0f/9;
-                        }
-                    }
-                    bmp24_applyFilter(processedImage, kernel, 3);
-                    for (int j = 0; j < 3; j++) {
-                        free(kernel[j]);
-                    }
-                    free(kernel);
+                    // 3 x 3 mean; near the border only the pixels inside the image are averaged
+                    bmp24_boxFilter(processedImage, 1);
                     snprintf(outputFilename, MAX_FILENAME, "%s/filtered_%d_%s", RESULT_FOLDER, i + 1, filename);
                     bmp24_saveImage(processedImage, outputFilename);
                     printf("Saved filtered image as %s\n", outputFilename);
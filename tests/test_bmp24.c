@@ -0,0 +1,378 @@
+/**
+ * Regression tests for the 24-bit image library
+ *
+ * Images are written to small files by hand, then read back through every
+ * loader and compared pixel by pixel; broken headers must be rejected.
+ */
+
+#include "bmp24.h"
+#include "test_util.h"
+#include <limits.h>
+#include <math.h>
+
+#define TEST_FILE "test_bmp24.bmp"
+#define TEST_COPY "test_bmp24_copy.bmp"
+
+/* 1 when the image holds the top-down RGB rows */
+static int testSamePixels(const t_bmp24 *img, const uint8_t *rgb, int width, int height) {
+    if (!img || img->width != width || img->height != height) return 0;
+    for (int y = 0; y < height; y++) {
+        const t_pixel *row = bmp24_row(img, y);
+        for (int x = 0; x < width; x++) {
+            const uint8_t *p = rgb + ((size_t)y * width + x) * 3;
+            if (row[x].red != p[0] || row[x].green != p[1] || row[x].blue != p[2]) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Loads top-down RGB rows through a file, as every caller gets an image */
+static t_bmp24 *testImage(const uint8_t *rgb, int width, int height) {
+    testWriteBmp24(TEST_FILE, width, height, 0, rgb);
+    t_bmp24 *img = bmp24_loadImage(TEST_FILE);
+    remove(TEST_FILE);
+    return img;
+}
+
+/* Slab layout, bottom-up and top-down files, and a save / load round trip */
+static void testLoadSave(void) {
+    static const int widths[] = {1, 5, 37};
+    for (int w = 0; w < 3; w++) {
+        int width = widths[w], height = 23;
+        uint8_t *rgb = (uint8_t *)malloc((size_t)width * height * 3);
+        testFill(rgb, (size_t)width * height * 3);
+
+        for (int topDown = 0; topDown <= 1; topDown++) {
+            testWriteBmp24(TEST_FILE, width, height, topDown, rgb);
+            t_bmp24 *img = bmp24_loadImage(TEST_FILE);
+            testCheck(testSamePixels(img, rgb, width, height), "bmp24_loadImage", width);
+            if (!img) continue;
+            testCheck(img->stride % BMP24_ALIGNMENT == 0 && (size_t)img->stride >= (size_t)width * 3,
+                      "bmp24 stride", width);
+            testCheck((uint8_t *)img->data[height - 1] == (uint8_t *)img->data[0] + (size_t)(height - 1) * img->stride,
+                      "bmp24 slab rows", width);
+            testCheck(img->header_info.height == height, "bmp24 top-down header", width);
+
+            bmp24_saveImage(img, TEST_COPY);
+            t_bmp24 *copy = bmp24_loadImage(TEST_COPY);
+            testCheck(testSamePixels(copy, rgb, width, height), "bmp24_saveImage", width);
+            bmp24_free(copy);
+            bmp24_free(img);
+        }
+        free(rgb);
+    }
+    remove(TEST_FILE);
+    remove(TEST_COPY);
+}
+
+/* 1 when a file can be opened for reading */
+static int testExists(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file) fclose(file);
+    return file != NULL;
+}
+
+/* In-place edits of a copy, of the file itself, and of the same path given twice */
+static void testEditFile(void) {
+    int width = 13, height = 7;
+    size_t bytes = (size_t)width * height * 3;
+    uint8_t rgb[13 * 7 * 3], negated[13 * 7 * 3], brighter[13 * 7 * 3];
+    testFill(rgb, bytes);
+    for (size_t i = 0; i < bytes; i++) {
+        negated[i] = (uint8_t)(255 - rgb[i]);
+        brighter[i] = (uint8_t)(negated[i] > 215 ? 255 : negated[i] + 40);
+    }
+
+    for (int topDown = 0; topDown <= 1; topDown++) {
+        testWriteBmp24(TEST_FILE, width, height, topDown, rgb);
+        testCheck(bmp24_negativeFile(TEST_FILE, TEST_COPY) == 0, "bmp24_negativeFile", topDown);
+        t_bmp24 *img = bmp24_loadImage(TEST_COPY);
+        testCheck(testSamePixels(img, negated, width, height), "bmp24_negativeFile copy", topDown);
+        bmp24_free(img);
+        img = bmp24_loadImage(TEST_FILE);
+        testCheck(testSamePixels(img, rgb, width, height), "bmp24_negativeFile source", topDown);
+        bmp24_free(img);
+
+        testCheck(bmp24_negativeFile(TEST_FILE, NULL) == 0, "bmp24_negativeFile in place", topDown);
+        testCheck(bmp24_brightnessFile(TEST_FILE, TEST_FILE, 40) == 0, "bmp24_brightnessFile same file", topDown);
+        img = bmp24_loadImage(TEST_FILE);
+        testCheck(testSamePixels(img, brighter, width, height), "bmp24 in-place edits", topDown);
+        bmp24_free(img);
+    }
+
+    // Invalid sources leave no copy behind
+    remove(TEST_COPY);
+    testWriteHeaderOnly(TEST_FILE, 0, 4, 24, 64);
+    testCheck(bmp24_negativeFile(TEST_FILE, TEST_COPY) != 0 && !testExists(TEST_COPY), "bmp24_negativeFile bad size", 0);
+    testWriteHeaderOnly(TEST_FILE, 64, 64, 24, 64);
+    testCheck(bmp24_negativeFile(TEST_FILE, TEST_COPY) != 0 && !testExists(TEST_COPY), "bmp24_negativeFile truncated", 0);
+    remove(TEST_FILE);
+    remove(TEST_COPY);
+}
+
+/* Crops of bottom-up and top-down files match the same crop of the full image */
+static void testLoadRegion(void) {
+    static const int regions[][4] = {{3, 5, 11, 7}, {0, 0, 29, 17}, {28, 16, 1, 1}, {0, 9, 4, 8}};
+    int width = 29, height = 17;
+    uint8_t rgb[29 * 17 * 3], crop[29 * 17 * 3];
+    testFill(rgb, sizeof(rgb));
+
+    for (int topDown = 0; topDown <= 1; topDown++) {
+        testWriteBmp24(TEST_FILE, width, height, topDown, rgb);
+        for (int r = 0; r < 4; r++) {
+            int x = regions[r][0], y = regions[r][1], w = regions[r][2], h = regions[r][3];
+            for (int j = 0; j < h; j++) {
+                memcpy(crop + (size_t)j * w * 3, rgb + ((size_t)(y + j) * width + x) * 3, (size_t)w * 3);
+            }
+            t_bmp24 *img = bmp24_loadRegion(TEST_FILE, x, y, w, h);
+            testCheck(testSamePixels(img, crop, w, h), "bmp24_loadRegion", r);
+            testCheck(img && img->header_info.width == w && img->header_info.height == h,
+                      "bmp24_loadRegion header", r);
+            bmp24_free(img);
+        }
+
+        testCheck(bmp24_loadRegion(TEST_FILE, -1, 0, 4, 4) == NULL, "bmp24_loadRegion negative", topDown);
+        testCheck(bmp24_loadRegion(TEST_FILE, 0, 0, 4, 0) == NULL, "bmp24_loadRegion empty", topDown);
+        testCheck(bmp24_loadRegion(TEST_FILE, 26, 0, 4, 4) == NULL, "bmp24_loadRegion outside", topDown);
+        testCheck(bmp24_loadRegion(TEST_FILE, INT_MAX, 0, 2, 4) == NULL, "bmp24_loadRegion wrap", topDown);
+    }
+    remove(TEST_FILE);
+}
+
+/* Fused per-channel chains against the operations one after the other */
+static void testLut(void) {
+    int width = 33, height = 9;
+    uint8_t rgb[33 * 9 * 3], expected[33 * 9 * 3], curve[256];
+    testFill(rgb, sizeof(rgb));
+    testFill(curve, sizeof(curve));
+    t_bmp24 *fused = testImage(rgb, width, height);
+    t_bmp24 *steps = testImage(rgb, width, height);
+    if (!fused || !steps) {
+        testCheck(0, "bmp24 LUT images", 0);
+        bmp24_free(fused);
+        bmp24_free(steps);
+        return;
+    }
+
+    t_bmp24_lut lut;
+    bmp24_lutInit(&lut);
+    bmp24_lutNegative(&lut);
+    bmp24_lutBrightness(&lut, -20);
+    bmp24_lutCurve(&lut, NULL, curve, NULL);
+    bmp24_applyLUT(fused, &lut);
+
+    bmp24_negative(steps);
+    bmp24_brightness(steps, -20);
+    for (int y = 0; y < height; y++) {
+        t_pixel *row = bmp24_row(steps, y);
+        for (int x = 0; x < width; x++) row[x].green = curve[row[x].green];
+    }
+    for (int y = 0; y < height; y++) {
+        memcpy(expected + (size_t)y * width * 3, bmp24_row(steps, y), (size_t)width * 3);
+    }
+    testCheck(testSamePixels(fused, expected, width, height), "bmp24_applyLUT chain", 0);
+
+    // Full-range levels and a gamma of 1 leave the table unchanged
+    bmp24_lutInit(&lut);
+    bmp24_lutLevels(&lut, 0, 255, 0, 255);
+    bmp24_lutGamma(&lut, 1.0f);
+    int identity = 1;
+    for (int i = 0; i < 256; i++) identity &= lut.red[i] == i && lut.green[i] == i && lut.blue[i] == i;
+    testCheck(identity, "bmp24_lutLevels / bmp24_lutGamma identity", 0);
+
+    // Levels clamp below inLow and above inHigh, and stay monotonic in between
+    bmp24_lutInit(&lut);
+    bmp24_lutLevels(&lut, 10, 200, 5, 250);
+    int levels = lut.red[0] == 5 && lut.red[10] == 5 && lut.red[200] == 250 && lut.red[255] == 250;
+    for (int i = 1; i < 256; i++) levels &= lut.red[i] >= lut.red[i - 1];
+    testCheck(levels, "bmp24_lutLevels", 0);
+    bmp24_free(fused);
+    bmp24_free(steps);
+}
+
+/* Luma of both standards within one level of the exact weighted sum, saved as a valid 8-bit file */
+static void testToBmp8(void) {
+    static const double weights[2][3] = {{0.299, 0.587, 0.114}, {0.2126, 0.7152, 0.0722}};
+    int width = 27, height = 11;
+    uint8_t rgb[27 * 11 * 3];
+    testFill(rgb, sizeof(rgb));
+    t_bmp24 *img = testImage(rgb, width, height);
+
+    for (int standard = BMP24_LUMA_BT601; standard <= BMP24_LUMA_BT709; standard++) {
+        t_bmp8 *gray = img ? bmp24_toBmp8(img, standard) : NULL;
+        testCheck(gray && gray->width == (unsigned int)width && gray->height == (unsigned int)height &&
+                  gray->colorDepth == 8 && gray->dataSize == 28u * height, "bmp24_toBmp8 size", standard);
+        if (!gray) continue;
+        double worst = 0;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const uint8_t *p = rgb + ((size_t)y * width + x) * 3;
+                double luma = weights[standard][0] * p[0] + weights[standard][1] * p[1] + weights[standard][2] * p[2];
+                // 8-bit data is bottom-up
+                double d = fabs(gray->data[(size_t)(height - 1 - y) * 28 + x] - luma);
+                if (d > worst) worst = d;
+            }
+        }
+        testCheck(worst <= 1.0, "bmp24_toBmp8 luma", standard);
+        testCheck(gray->colorTable[4 * 200] == 200 && gray->colorTable[4 * 200 + 2] == 200, "bmp24_toBmp8 palette",
+                  standard);
+
+        bmp8_saveImage(TEST_COPY, gray);
+        t_bmp8 *copy = bmp8_loadImage(TEST_COPY);
+        testCheck(copy && copy->dataSize == gray->dataSize && memcmp(copy->data, gray->data, gray->dataSize) == 0,
+                  "bmp24_toBmp8 saved", standard);
+        bmp8_free(copy);
+        bmp8_free(gray);
+    }
+    bmp24_free(img);
+    remove(TEST_COPY);
+}
+
+/* Grey images equalize exactly like 8-bit ones; colours keep their chroma */
+static void testEqualize(void) {
+    int width = 31, height = 19;
+    uint8_t rgb[31 * 19 * 3], expected[31 * 19 * 3];
+    unsigned int hist[256] = {0};
+    for (int i = 0; i < width * height; i++) {
+        uint8_t v = (uint8_t)(60 + testRandom() % 90);  // Narrow range, so equalizing stretches it
+        rgb[3 * i] = rgb[3 * i + 1] = rgb[3 * i + 2] = v;
+        hist[v]++;
+    }
+    unsigned int *cdf = bmp8_computeCDF(hist, (unsigned int)(width * height));
+    for (int i = 0; cdf && i < width * height * 3; i++) expected[i] = (uint8_t)cdf[rgb[i]];
+    t_bmp24 *img = testImage(rgb, width, height);
+    if (img) bmp24_equalize(img);
+    testCheck(cdf && testSamePixels(img, expected, width, height), "bmp24_equalize grey", 0);
+    bmp24_free(img);
+    free(cdf);
+
+    // Cb and Cr of unclamped pixels survive the round trip through the equalized luma
+    for (int i = 0; i < width * height * 3; i++) rgb[i] = (uint8_t)(70 + testRandom() % 110);
+    img = testImage(rgb, width, height);
+    if (img) bmp24_equalize(img);
+    double worst = img ? 0 : 255;
+    for (int y = 0; img && y < height; y++) {
+        const t_pixel *row = bmp24_row(img, y);
+        for (int x = 0; x < width; x++) {
+            const uint8_t *p = rgb + ((size_t)y * width + x) * 3;
+            int r = row[x].red, g = row[x].green, b = row[x].blue;
+            if (r == 0 || r == 255 || g == 0 || g == 255 || b == 0 || b == 255) continue;
+            double cbIn = -0.168736 * p[0] - 0.331264 * p[1] + 0.5 * p[2];
+            double crIn = 0.5 * p[0] - 0.418688 * p[1] - 0.081312 * p[2];
+            double cbOut = -0.168736 * r - 0.331264 * g + 0.5 * b;
+            double crOut = 0.5 * r - 0.418688 * g - 0.081312 * b;
+            if (fabs(cbIn - cbOut) > worst) worst = fabs(cbIn - cbOut);
+            if (fabs(crIn - crOut) > worst) worst = fabs(crIn - crOut);
+        }
+    }
+    testCheck(worst <= 2.0, "bmp24_equalize chroma", (int)worst);
+    bmp24_free(img);
+}
+
+/* Each channel has its own table, in image rows from the top */
+static void testIntegral(void) {
+    int width = 17, height = 12;
+    uint8_t rgb[17 * 12 * 3];
+    testFill(rgb, sizeof(rgb));
+    t_bmp24 *img = testImage(rgb, width, height);
+    t_bmp_integral *integral = img ? bmp24_integral(img) : NULL;
+    testCheck(integral && integral->channels == 3, "bmp24_integral", 0);
+    for (int c = 0; integral && c < 3; c++) {
+        // Pixel 2..9 of rows 1..4, then the bottom-right corner
+        uint64_t sum = 0;
+        for (int y = 1; y < 5; y++) {
+            for (int x = 2; x < 10; x++) sum += rgb[((size_t)y * width + x) * 3 + c];
+        }
+        testCheck(bmp_integralSum(integral, 2, 1, 8, 4, c) == sum, "bmp24 integral sum", c);
+        testCheck(bmp_integralSum(integral, width - 1, height - 1, 5, 5, c) == rgb[((size_t)height * width - 1) * 3 + c],
+                  "bmp24 integral corner", c);
+    }
+    bmp_integralFree(integral);
+    bmp24_free(img);
+}
+
+/* size x size kernel whose only tap moves every pixel left by shift columns */
+static float **testShiftKernel(int size, int shift) {
+    float **kernel = (float **)malloc(size * sizeof(float *));
+    for (int i = 0; i < size; i++) kernel[i] = (float *)calloc(size, sizeof(float));
+    kernel[size / 2][size / 2 + shift] = 1.0f;
+    return kernel;
+}
+
+static void testFreeKernel(float **kernel, int size) {
+    for (int i = 0; i < size; i++) free(kernel[i]);
+    free(kernel);
+}
+
+/* Kernels of any odd size are accepted; outside the image is zero */
+static void testLargeKernel(void) {
+    int width = 41, height = 9, size = 65;
+    uint8_t rgb[41 * 9 * 3], expected[41 * 9 * 3];
+    testFill(rgb, sizeof(rgb));
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < 3; c++) {
+                size_t i = ((size_t)y * width + x) * 3 + c;
+                expected[i] = x + 3 < width ? rgb[i + 9] : 0;
+            }
+        }
+    }
+    t_bmp24 *img = testImage(rgb, width, height);
+    float **kernel = testShiftKernel(size, 3);
+    if (img) bmp24_applyFilter(img, kernel, size);
+    testCheck(testSamePixels(img, expected, width, height), "bmp24_applyFilter 65 taps", size);
+    bmp24_free(img);
+    testFreeKernel(kernel, size);
+}
+
+/* Header fields come back as stored, top-down files keep their negative height */
+static void testProbe(void) {
+    uint8_t rgb[9 * 5 * 3];
+    testFill(rgb, sizeof(rgb));
+    testWriteBmp24(TEST_FILE, 9, 5, 1, rgb);
+    t_bmp_probe info;
+    testCheck(bmp24_probe(TEST_FILE, &info) == 0 && info.width == 9 && info.height == -5 &&
+              info.colorDepth == 24 && info.offset == 54 && info.compression == 0 && info.imageSize == 5 * 28,
+              "bmp24_probe", 0);
+    testCheck(bmp8_probe(TEST_FILE, &info) != 0, "bmp8_probe on 24-bit", 0);
+
+    FILE *file = fopen(TEST_FILE, "wb");
+    if (file) {
+        fputs("not a bitmap, but longer than the 54 bytes of BMP headers........", file);
+        fclose(file);
+    }
+    testCheck(bmp24_probe(TEST_FILE, &info) != 0, "bmp24_probe on text", 0);
+    testCheck(bmp24_probe("test_bmp24_missing.bmp", &info) != 0, "bmp24_probe missing file", 0);
+    remove(TEST_FILE);
+}
+
+/* Sizes read from the file must never wrap the stride or the pixel array */
+static void testBadHeaders(void) {
+    static const int32_t sizes[][2] = {
+        {0, 4}, {-4, 4}, {4, 0}, {4, INT_MIN}, {INT_MAX, 1}, {(INT_MAX / 3) + 1, 1}, {70000, 70000}, {70000, -70000}
+    };
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        testWriteHeaderOnly(TEST_FILE, sizes[i][0], sizes[i][1], 24, 64);
+        t_bmp24 *img = bmp24_loadImage(TEST_FILE);
+        testCheck(img == NULL, "bmp24_loadImage bad size", i);
+        bmp24_free(img);
+    }
+    remove(TEST_FILE);
+
+    testCheck(bmp24_rowStride(INT_MAX) >= (size_t)INT_MAX * 3, "bmp24_rowStride wide", 0);
+    testCheck(bmp24_allocate(INT_MAX, 1, 24) == NULL, "bmp24_allocate wide", 0);
+}
+
+int main(void) {
+    testLoadSave();
+    testEditFile();
+    testLoadRegion();
+    testProbe();
+    testLut();
+    testToBmp8();
+    testEqualize();
+    testLargeKernel();
+    testIntegral();
+    testBadHeaders();
+    return testReport("test_bmp24");
+}
@@ -0,0 +1,554 @@
+/**
+ * Regression tests for the 8-bit image library
+ *
+ * Images are written to small files by hand and read back through the
+ * loaders; the operations are compared against straightforward per-pixel
+ * versions of what they compute.
+ */
+
+#include "bmp8.h"
+#include "test_util.h"
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define TEST_FILE "test_bmp8.bmp"
+#define TEST_COPY "test_bmp8_copy.bmp"
+
+/* Pixel (x, y) counted from the top: 8-bit data keeps the bottom-up file order */
+static unsigned char testPixel(const t_bmp8 *img, unsigned int x, unsigned int y) {
+    unsigned int rowSize = (img->width + 3) & ~3u;
+    return img->data[(size_t)(img->height - 1 - y) * rowSize + x];
+}
+
+/* 1 when the image holds the top-down rows of gray */
+static int testSameGray(const t_bmp8 *img, const uint8_t *gray, int width, int height) {
+    if (!img || (int)img->width != width || (int)img->height != height) return 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (testPixel(img, x, y) != gray[(size_t)y * width + x]) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Loads the top-down rows of gray through a file, as every caller gets an image */
+static t_bmp8 *testImage(const uint8_t *gray, int width, int height) {
+    testWriteBmp8(TEST_FILE, width, height, 0, gray);
+    t_bmp8 *img = bmp8_loadImage(TEST_FILE);
+    remove(TEST_FILE);
+    return img;
+}
+
+/* Mapped images see the same pixels as loaded ones; private edits stay out of the file */
+static void testMapImage(void) {
+    int width = 37, height = 19;
+    uint8_t gray[37 * 19];
+    testFill(gray, sizeof(gray));
+    testWriteBmp8(TEST_FILE, width, height, 0, gray);
+
+    t_bmp8 *loaded = bmp8_loadImage(TEST_FILE);
+    testCheck(testSameGray(loaded, gray, width, height), "bmp8_loadImage", 0);
+    bmp8_free(loaded);
+
+    t_bmp8 *mapped = bmp8_mapImage(TEST_FILE, BMP_MAP_READONLY);
+    testCheck(testSameGray(mapped, gray, width, height), "bmp8_mapImage read-only", 0);
+    bmp8_free(mapped);
+
+    mapped = bmp8_mapImage(TEST_FILE, BMP_MAP_PRIVATE);
+    testCheck(testSameGray(mapped, gray, width, height), "bmp8_mapImage private", 0);
+    if (mapped) bmp8_negative(mapped);
+    bmp8_free(mapped);
+    loaded = bmp8_loadImage(TEST_FILE);
+    testCheck(testSameGray(loaded, gray, width, height), "bmp8_mapImage private write", 0);
+    bmp8_free(loaded);
+
+    // Pixel array past the end of the file
+    FILE *file = fopen(TEST_FILE, "r+b");
+    if (file) {
+        fseek(file, 22, SEEK_SET);
+        uint8_t taller[4] = {(uint8_t)(height + 1), 0, 0, 0};
+        fwrite(taller, 1, 4, file);
+        fclose(file);
+    }
+    mapped = bmp8_mapImage(TEST_FILE, BMP_MAP_READONLY);
+    testCheck(mapped == NULL, "bmp8_mapImage truncated", 0);
+    bmp8_free(mapped);
+    remove(TEST_FILE);
+}
+
+/* 1 when a file can be opened for reading */
+static int testExists(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file) fclose(file);
+    return file != NULL;
+}
+
+/* Edits go to the copy only, or to the file itself when both paths are the same */
+static void testMapCopy(void) {
+    int width = 21, height = 11;
+    uint8_t gray[21 * 11], negated[21 * 11];
+    testFill(gray, sizeof(gray));
+    for (size_t i = 0; i < sizeof(gray); i++) negated[i] = (uint8_t)(255 - gray[i]);
+    testWriteBmp8(TEST_FILE, width, height, 0, gray);
+
+    t_bmp8 *copy = bmp8_mapCopy(TEST_FILE, TEST_COPY);
+    testCheck(testSameGray(copy, gray, width, height), "bmp8_mapCopy", 0);
+    if (copy) bmp8_negative(copy);
+    bmp8_free(copy);
+    t_bmp8 *img = bmp8_loadImage(TEST_COPY);
+    testCheck(testSameGray(img, negated, width, height), "bmp8_mapCopy edits the copy", 0);
+    bmp8_free(img);
+    img = bmp8_loadImage(TEST_FILE);
+    testCheck(testSameGray(img, gray, width, height), "bmp8_mapCopy keeps the source", 0);
+    bmp8_free(img);
+
+    // Same path: the file is edited in place instead of being emptied
+    copy = bmp8_mapCopy(TEST_FILE, TEST_FILE);
+    testCheck(testSameGray(copy, gray, width, height), "bmp8_mapCopy same file", 0);
+    if (copy) bmp8_negative(copy);
+    bmp8_free(copy);
+    img = bmp8_loadImage(TEST_FILE);
+    testCheck(testSameGray(img, negated, width, height), "bmp8_mapCopy same file edit", 0);
+    bmp8_free(img);
+
+    // A source that is not a valid image leaves no copy behind
+    remove(TEST_COPY);
+    testWriteHeaderOnly(TEST_FILE, 0x40000000, 8, 8, 64);
+    copy = bmp8_mapCopy(TEST_FILE, TEST_COPY);
+    testCheck(copy == NULL && !testExists(TEST_COPY), "bmp8_mapCopy bad source", 0);
+    bmp8_free(copy);
+    remove(TEST_FILE);
+    remove(TEST_COPY);
+}
+
+/* Crops of bottom-up and top-down files match the same crop of the full image */
+static void testLoadRegion(void) {
+    static const unsigned int regions[][4] = {{3, 5, 11, 7}, {0, 0, 37, 19}, {36, 18, 1, 1}, {0, 10, 4, 9}};
+    int width = 37, height = 19;
+    uint8_t gray[37 * 19], crop[37 * 19];
+    testFill(gray, sizeof(gray));
+
+    for (int topDown = 0; topDown <= 1; topDown++) {
+        testWriteBmp8(TEST_FILE, width, height, topDown, gray);
+        for (int r = 0; r < 4; r++) {
+            unsigned int x = regions[r][0], y = regions[r][1], w = regions[r][2], h = regions[r][3];
+            for (unsigned int j = 0; j < h; j++) memcpy(crop + j * w, gray + (y + j) * width + x, w);
+            t_bmp8 *img = bmp8_loadRegion(TEST_FILE, x, y, w, h);
+            testCheck(testSameGray(img, crop, (int)w, (int)h), "bmp8_loadRegion", r);
+            bmp8_free(img);
+        }
+
+        // Empty, outside, or wrapping x + w
+        testCheck(bmp8_loadRegion(TEST_FILE, 0, 0, 0, 4) == NULL, "bmp8_loadRegion empty", topDown);
+        testCheck(bmp8_loadRegion(TEST_FILE, 30, 0, 8, 4) == NULL, "bmp8_loadRegion outside", topDown);
+        testCheck(bmp8_loadRegion(TEST_FILE, 0, 0, 4, 20) == NULL, "bmp8_loadRegion below", topDown);
+        testCheck(bmp8_loadRegion(TEST_FILE, 0xFFFFFFF0u, 0, 32, 4) == NULL, "bmp8_loadRegion wrap", topDown);
+    }
+    remove(TEST_FILE);
+}
+
+/* A fused chain gives the same bytes as the operations one after the other */
+static void testLut(void) {
+    int width = 45, height = 13;
+    uint8_t gray[45 * 13], curve[256];
+    testFill(gray, sizeof(gray));
+    testFill(curve, sizeof(curve));
+    t_bmp8 *fused = testImage(gray, width, height);
+    t_bmp8 *steps = testImage(gray, width, height);
+    if (!fused || !steps) {
+        testCheck(0, "bmp8 LUT images", 0);
+        bmp8_free(fused);
+        bmp8_free(steps);
+        return;
+    }
+
+    t_bmp8_lut lut;
+    bmp8_lutInit(&lut);
+    bmp8_lutNegative(&lut);
+    bmp8_lutBrightness(&lut, 40);
+    bmp8_lutCurve(&lut, curve);
+    bmp8_lutThreshold(&lut, 100);
+    bmp8_applyLUT(fused, &lut);
+
+    bmp8_negative(steps);
+    bmp8_brightness(steps, 40);
+    for (unsigned int i = 0; i < steps->dataSize; i++) steps->data[i] = curve[steps->data[i]];
+    bmp8_threshold(steps, 100);
+    testCheck(memcmp(fused->data, steps->data, fused->dataSize) == 0, "bmp8_applyLUT chain", 0);
+
+    // Equalizing after a negative uses the histogram of the negated pixels
+    testFill(fused->data, fused->dataSize);
+    memcpy(steps->data, fused->data, fused->dataSize);
+    unsigned int *hist = bmp8_computeHistogram(fused);
+    bmp8_lutInit(&lut);
+    bmp8_lutNegative(&lut);
+    testCheck(hist && bmp8_lutEqualize(&lut, hist) == 0, "bmp8_lutEqualize", 0);
+    bmp8_applyLUT(fused, &lut);
+
+    bmp8_negative(steps);
+    unsigned int *negHist = bmp8_computeHistogram(steps);
+    unsigned int *cdf = negHist ? bmp8_computeCDF(negHist, steps->width * steps->height) : NULL;
+    if (cdf) bmp8_equalize(steps, cdf);
+    // Only the pixels count: padding bytes are not part of the histogram
+    int same = cdf != NULL;
+    for (int y = 0; same && y < height; y++) {
+        for (int x = 0; x < width; x++) same &= testPixel(fused, x, y) == testPixel(steps, x, y);
+    }
+    testCheck(same, "bmp8_lutEqualize after negative", 0);
+    free(hist);
+    free(negHist);
+    free(cdf);
+    bmp8_free(fused);
+    bmp8_free(steps);
+}
+
+/* Banked, threaded counts against a plain count; padding bytes are not pixels */
+static void testHistogram(void) {
+    static const int sizes[][2] = {{1, 1}, {3, 5}, {45, 13}, {301, 257}};  // The last one is split across threads
+    for (int s = 0; s < 4; s++) {
+        int width = sizes[s][0], height = sizes[s][1];
+        uint8_t *gray = (uint8_t *)malloc((size_t)width * height);
+        testFill(gray, (size_t)width * height);
+        t_bmp8 *img = testImage(gray, width, height);
+        // Padding bytes set to 255, so counting them would show
+        if (img) memset(img->data, 255, img->dataSize);
+        for (int y = 0; img && y < height; y++) {
+            memcpy(img->data + (size_t)(height - 1 - y) * ((width + 3) & ~3), gray + (size_t)y * width, (size_t)width);
+        }
+
+        unsigned int expected[256] = {0};
+        for (size_t i = 0; i < (size_t)width * height; i++) expected[gray[i]]++;
+        for (int threads = 1; threads <= 4; threads += 3) {
+#ifdef _OPENMP
+            omp_set_num_threads(threads);
+#endif
+            unsigned int *hist = img ? bmp8_computeHistogram(img) : NULL;
+            testCheck(hist && memcmp(hist, expected, sizeof(expected)) == 0, "bmp8_computeHistogram", width);
+            free(hist);
+        }
+        bmp8_free(img);
+        free(gray);
+    }
+}
+
+/* Statistics gathered while loading match a count of the loaded pixels */
+static void testLoadStats(void) {
+    static const int widths[] = {1, 6, 45};
+    for (int w = 0; w < 3; w++) {
+        int width = widths[w], height = 17;
+        uint8_t gray[45 * 17];
+        testFill(gray, sizeof(gray));
+        // Keep the extremes off 0 and 255, so a min or max left at its initial value shows
+        for (int i = 0; i < width * height; i++) gray[i] = (uint8_t)(20 + gray[i] % 200);
+
+        testWriteBmp8(TEST_FILE, width, height, 0, gray);
+        t_bmp8_stats stats;
+        t_bmp8 *img = bmp8_loadImageStats(TEST_FILE, &stats);
+        testCheck(testSameGray(img, gray, width, height), "bmp8_loadImageStats pixels", width);
+        unsigned int *hist = img ? bmp8_computeHistogram(img) : NULL;
+        testCheck(hist && memcmp(hist, stats.histogram, sizeof(stats.histogram)) == 0,
+                  "bmp8_loadImageStats histogram", width);
+
+        unsigned char low = 255, high = 0;
+        unsigned long long sum = 0;
+        for (int i = 0; i < width * height; i++) {
+            if (gray[i] < low) low = gray[i];
+            if (gray[i] > high) high = gray[i];
+            sum += gray[i];
+        }
+        testCheck(stats.min == low && stats.max == high && stats.sum == sum, "bmp8_loadImageStats min / max / sum",
+                  width);
+        free(hist);
+        bmp8_free(img);
+    }
+
+    // A truncated file is refused like bmp8_loadImage does
+    testWriteHeaderOnly(TEST_FILE, 64, 64, 8, 64);
+    t_bmp8_stats stats;
+    testCheck(bmp8_loadImageStats(TEST_FILE, &stats) == NULL, "bmp8_loadImageStats truncated", 0);
+    remove(TEST_FILE);
+}
+
+/* Equalization table of one tile: levels below its darkest pixel map to 0 */
+static void testTileLut(const t_bmp8 *img, int x0, int y0, int w, int h, double *lut) {
+    unsigned int rowSize = (img->width + 3) & ~3u;
+    unsigned int hist[256] = {0}, cdf = 0, cdfmin = 0;
+    for (int y = y0; y < y0 + h; y++) {
+        for (int x = x0; x < x0 + w; x++) hist[img->data[(size_t)y * rowSize + x]]++;
+    }
+    for (int i = 0; i < 256; i++) {
+        cdf += hist[i];
+        if (cdfmin == 0) cdfmin = cdf;
+        if (cdfmin == (unsigned int)(w * h)) lut[i] = i;
+        else lut[i] = cdf < cdfmin ? 0 : round((double)(cdf - cdfmin) / (w * h - cdfmin) * 255.0);
+    }
+}
+
+/*
+ * Quadrants with disjoint grey ranges, 2 x 2 tiles and no clipping: every
+ * pixel is within one level of the bilinear blend of its four tile tables,
+ * including the entries below a tile's darkest pixel
+ */
+static void testClahe(void) {
+    static const int ranges[][4][2] = {
+        {{150, 50}, {0, 40}, {150, 50}, {0, 40}},    // Left half 150..199, right half 0..39
+        {{150, 50}, {0, 40}, {60, 40}, {200, 56}}
+    };
+    int width = 64, height = 64, tile = 32;
+    for (int r = 0; r < 2; r++) {
+        uint8_t gray[64 * 64];
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const int *range = ranges[r][(y >= tile) * 2 + (x >= tile)];
+                gray[y * width + x] = (uint8_t)(range[0] + testRandom() % range[1]);
+            }
+        }
+        t_bmp8 *img = testImage(gray, width, height);
+        if (!img) {
+            testCheck(0, "bmp8_clahe image", r);
+            continue;
+        }
+
+        double luts[4][256];
+        for (int t = 0; t < 4; t++) testTileLut(img, (t % 2) * tile, (t / 2) * tile, tile, tile, luts[t]);
+        uint8_t *before = (uint8_t *)malloc(img->dataSize);
+        memcpy(before, img->data, img->dataSize);
+        bmp8_clahe(img, 2, 2, 0);
+
+        double worst = 0;
+        for (int y = 0; y < height; y++) {
+            // Tile centres at 16 and 48, clamped outside them
+            double wy = (y + 0.5) / tile - 0.5;
+            wy = wy < 0 ? 0 : (wy > 1 ? 1 : wy);
+            for (int x = 0; x < width; x++) {
+                double wx = (x + 0.5) / tile - 0.5;
+                wx = wx < 0 ? 0 : (wx > 1 ? 1 : wx);
+                int v = before[y * 64 + x];
+                double top = luts[0][v] + wx * (luts[1][v] - luts[0][v]);
+                double bottom = luts[2][v] + wx * (luts[3][v] - luts[2][v]);
+                double d = fabs(img->data[y * 64 + x] - (top + wy * (bottom - top)));
+                if (d > worst) worst = d;
+            }
+        }
+        testCheck(worst <= 1.0, "bmp8_clahe blend", r);
+        free(before);
+        bmp8_free(img);
+    }
+}
+
+/* Otsu by brute force: the lowest t maximizing w0 * w1 * (m0 - m1)^2 */
+static int testOtsu(const unsigned int *hist) {
+    double best = -1;
+    int threshold = 0;
+    for (int t = 0; t < 255; t++) {
+        double w0 = 0, w1 = 0, s0 = 0, s1 = 0;
+        for (int i = 0; i < 256; i++) {
+            if (i <= t) { w0 += hist[i]; s0 += (double)i * hist[i]; }
+            else { w1 += hist[i]; s1 += (double)i * hist[i]; }
+        }
+        if (w0 == 0 || w1 == 0) continue;
+        double between = w0 * w1 * (s0 / w0 - s1 / w1) * (s0 / w0 - s1 / w1);
+        if (between > best * (1 + 1e-12)) {
+            best = between;
+            threshold = t;
+        }
+    }
+    return threshold;
+}
+
+/* Every method splits two separate modes between them; autoThreshold binarizes at its choice */
+static void testThresholds(void) {
+    // Two bumps around 50 and 190, the brighter one smaller
+    unsigned int hist[256] = {0};
+    for (int i = 0; i < 256; i++) {
+        double d0 = (i - 50) / 12.0, d1 = (i - 190) / 15.0;
+        hist[i] = (unsigned int)(1000 * exp(-d0 * d0 / 2) + 400 * exp(-d1 * d1 / 2));
+    }
+    int otsu = bmp8_otsuThreshold(hist);
+    int triangle = bmp8_triangleThreshold(hist);
+    int yen = bmp8_yenThreshold(hist);
+    testCheck(otsu == testOtsu(hist), "bmp8_otsuThreshold brute force", otsu);
+    testCheck(otsu > 50 && otsu < 190, "bmp8_otsuThreshold bimodal", otsu);
+    testCheck(triangle > 50 && triangle < 190, "bmp8_triangleThreshold bimodal", triangle);
+    testCheck(yen > 50 && yen < 190, "bmp8_yenThreshold bimodal", yen);
+
+    for (int r = 0; r < 8; r++) {
+        unsigned int random[256];
+        for (int i = 0; i < 256; i++) random[i] = testRandom() % 1000;
+        testCheck(bmp8_otsuThreshold(random) == testOtsu(random), "bmp8_otsuThreshold random", r);
+    }
+
+    // Peak near the dark end with a long bright tail: the cut lies between them
+    unsigned int tail[256] = {0};
+    for (int i = 20; i < 230; i++) tail[i] = i < 40 ? 5000 - 100 * (unsigned int)abs(i - 30) : (unsigned int)(3000 - 13 * i);
+    triangle = bmp8_triangleThreshold(tail);
+    testCheck(triangle > 30 && triangle < 229, "bmp8_triangleThreshold tail", triangle);
+
+    // A single level has nothing to split
+    unsigned int flat[256] = {0};
+    flat[77] = 100;
+    testCheck(bmp8_otsuThreshold(flat) == 77 && bmp8_triangleThreshold(flat) == 77 && bmp8_yenThreshold(flat) == 77,
+              "bmp8 thresholds single level", 0);
+
+    // Image drawn from the bimodal histogram
+    int width = 57, height = 23;
+    uint8_t gray[57 * 23];
+    for (int i = 0; i < width * height; i++) {
+        gray[i] = (uint8_t)(testRandom() % 3 ? 40 + testRandom() % 25 : 170 + testRandom() % 40);
+    }
+    for (int method = BMP8_THRESHOLD_OTSU; method <= BMP8_THRESHOLD_YEN; method++) {
+        t_bmp8 *img = testImage(gray, width, height);
+        unsigned int *counted = img ? bmp8_computeHistogram(img) : NULL;
+        int chosen = !counted ? -1 : method == BMP8_THRESHOLD_OTSU ? bmp8_otsuThreshold(counted)
+                   : method == BMP8_THRESHOLD_TRIANGLE ? bmp8_triangleThreshold(counted) : bmp8_yenThreshold(counted);
+        // Without a histogram it is counted from the image first
+        int threshold = img ? bmp8_autoThreshold(img, method == BMP8_THRESHOLD_YEN ? counted : NULL, method) : -1;
+        testCheck(threshold == chosen && threshold >= 64 && threshold < 170, "bmp8_autoThreshold", method);
+        int binary = img != NULL;
+        for (int y = 0; binary && y < height; y++) {
+            for (int x = 0; x < width; x++) binary &= testPixel(img, x, y) == (gray[y * width + x] > threshold ? 255 : 0);
+        }
+        testCheck(binary, "bmp8_autoThreshold pixels", method);
+        free(counted);
+        bmp8_free(img);
+    }
+    t_bmp8 empty = {0};
+    testCheck(bmp8_autoThreshold(&empty, NULL, BMP8_THRESHOLD_OTSU) == -1, "bmp8_autoThreshold no data", 0);
+}
+
+/* Rectangle sums, means and variances against direct sums; adaptiveThreshold against its definition */
+static void testIntegral(void) {
+    // x, y, w, h in image coordinates; the last ones stick out of the image or are empty
+    static const int rects[][4] = {{0, 0, 1, 1}, {3, 2, 10, 7}, {0, 0, 29, 21}, {20, 15, 9, 6},
+                                   {-4, -3, 8, 8}, {25, 18, 10, 10}, {5, 5, 0, 3}, {40, 0, 3, 3}};
+    int width = 29, height = 21;
+    uint8_t gray[29 * 21];
+    testFill(gray, sizeof(gray));
+    t_bmp8 *img = testImage(gray, width, height);
+    t_bmp_integral *integral = bmp8_integral(img);
+    testCheck(integral != NULL, "bmp8_integral", 0);
+    for (int r = 0; integral && r < 8; r++) {
+        int x0 = rects[r][0], y0 = rects[r][1], x1 = x0 + rects[r][2], y1 = y0 + rects[r][3];
+        uint64_t sum = 0, sqsum = 0, count = 0;
+        for (int y = y0 > 0 ? y0 : 0; y < y1 && y < height; y++) {
+            for (int x = x0 > 0 ? x0 : 0; x < x1 && x < width; x++) {
+                sum += gray[y * width + x];
+                sqsum += (uint64_t)gray[y * width + x] * gray[y * width + x];
+                count++;
+            }
+        }
+        double mean = count ? (double)sum / count : 0;
+        double variance = count ? (double)sqsum / count - mean * mean : 0;
+        testCheck(bmp_integralSum(integral, x0, y0, rects[r][2], rects[r][3], 0) == sum, "bmp_integralSum", r);
+        testCheck(fabs(bmp_integralMean(integral, x0, y0, rects[r][2], rects[r][3], 0) - mean) < 1e-9,
+                  "bmp_integralMean", r);
+        testCheck(fabs(bmp_integralVariance(integral, x0, y0, rects[r][2], rects[r][3], 0) - variance) < 1e-6,
+                  "bmp_integralVariance", r);
+    }
+    bmp_integralFree(integral);
+
+    // A pixel is foreground when it is above the mean of its clipped window minus offset
+    static const int params[][2] = {{1, 0}, {3, 5}, {30, -10}};
+    for (int p = 0; img && p < 3; p++) {
+        int radius = params[p][0], offset = params[p][1];
+        t_bmp8 *thresholded = testImage(gray, width, height);
+        if (thresholded) bmp8_adaptiveThreshold(thresholded, radius, offset);
+        int same = thresholded != NULL;
+        for (int y = 0; same && y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int sum = 0, count = 0;
+                for (int v = y - radius; v <= y + radius; v++) {
+                    for (int u = x - radius; u <= x + radius; u++) {
+                        if (v < 0 || v >= height || u < 0 || u >= width) continue;
+                        sum += gray[v * width + u];
+                        count++;
+                    }
+                }
+                int expected = (gray[y * width + x] + offset) * count > sum ? 255 : 0;
+                same &= testPixel(thresholded, x, y) == expected;
+            }
+        }
+        testCheck(same, "bmp8_adaptiveThreshold", radius);
+        bmp8_free(thresholded);
+    }
+    bmp8_free(img);
+}
+
+/* size x size kernel whose only tap moves every pixel left by shift columns */
+static float **testShiftKernel(int size, int shift) {
+    float **kernel = (float **)malloc(size * sizeof(float *));
+    for (int i = 0; i < size; i++) kernel[i] = (float *)calloc(size, sizeof(float));
+    kernel[size / 2][size / 2 + shift] = 1.0f;
+    return kernel;
+}
+
+static void testFreeKernel(float **kernel, int size) {
+    for (int i = 0; i < size; i++) free(kernel[i]);
+    free(kernel);
+}
+
+/* Kernels of any odd size are accepted; pixels within size / 2 of the edges are kept */
+static void testLargeKernel(void) {
+    int width = 101, height = 71, size = 65, n = 32;
+    uint8_t gray[101 * 71];
+    testFill(gray, sizeof(gray));
+    t_bmp8 *img = testImage(gray, width, height);
+    float **kernel = testShiftKernel(size, 3);
+    if (img) bmp8_applyFilter(img, kernel, size);
+    int same = img != NULL;
+    for (int y = 0; same && y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int inside = x >= n && x < width - n && y >= n && y < height - n;
+            same &= testPixel(img, x, y) == gray[y * width + x + (inside ? 3 : 0)];
+        }
+    }
+    testCheck(same, "bmp8_applyFilter 65 taps", size);
+    bmp8_free(img);
+    testFreeKernel(kernel, size);
+}
+
+/* Header fields come back as stored */
+static void testProbe(void) {
+    uint8_t gray[10 * 3];
+    testFill(gray, sizeof(gray));
+    testWriteBmp8(TEST_FILE, 10, 3, 0, gray);
+    t_bmp_probe info;
+    testCheck(bmp8_probe(TEST_FILE, &info) == 0 && info.width == 10 && info.height == 3 && info.colorDepth == 8 &&
+              info.offset == 54 + 1024 && info.imageSize == 3 * 12 && info.fileSize == 54 + 1024 + 3 * 12,
+              "bmp8_probe", 0);
+    remove(TEST_FILE);
+    testCheck(bmp8_probe(TEST_FILE, &info) != 0, "bmp8_probe missing file", 0);
+}
+
+/* Sizes whose padded pixel array wraps 32 bits, or that do not fit int, are refused */
+static void testBadHeaders(void) {
+    static const int32_t sizes[][2] = {{0, 4}, {4, 0}, {0x40000000, 8}, {65536, 65536}, {4, -4}, {-4, 4}};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        testWriteHeaderOnly(TEST_FILE, sizes[i][0], sizes[i][1], 8, 64);
+        t_bmp8 *img = bmp8_loadImage(TEST_FILE);
+        testCheck(img == NULL, "bmp8_loadImage bad size", i);
+        bmp8_free(img);
+        img = bmp8_mapImage(TEST_FILE, BMP_MAP_READONLY);
+        testCheck(img == NULL, "bmp8_mapImage bad size", i);
+        bmp8_free(img);
+    }
+    remove(TEST_FILE);
+}
+
+int main(void) {
+    testMapImage();
+    testMapCopy();
+    testLoadRegion();
+    testProbe();
+    testLut();
+    testHistogram();
+    testLoadStats();
+    testClahe();
+    testThresholds();
+    testIntegral();
+    testLargeKernel();
+    testBadHeaders();
+    return testReport("test_bmp8");
+}
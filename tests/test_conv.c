@@ -0,0 +1,370 @@
+/**
+ * Regression tests for the convolution engine
+ *
+ * The fixed-point weighted sum is compared byte for byte against the scalar
+ * kernel at every SIMD level the CPU supports. The in-place plane filters are compared against a reference
+ * that filters a full copy of the image row by row, on one thread and on
+ * several; the FFT path is bounded against that reference.
+ */
+
+#include "bmp_simd.h"
+#include "bmp_conv.h"
+#include "bmp_fft.h"
+#include "test_util.h"
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Weighted Sums */
+
+#define TEST_SIMD_SIZE 4099  // Odd, so every vector loop leaves a tail
+
+static void testWeightedSumLevel(int level) {
+    static uint8_t runs[9][TEST_SIMD_SIZE];
+    static uint8_t expected[TEST_SIMD_SIZE], actual[TEST_SIMD_SIZE];
+    static const int divisors[] = {1, 9, 16, 25, 256, 1000, 1024, 16384};
+    const uint8_t *src[9];
+    int16_t weights[9];
+    for (int t = 0; t < 9; t++) {
+        testFill(runs[t], TEST_SIMD_SIZE);
+        src[t] = runs[t];
+    }
+
+    for (int d = 0; d < 8; d++) {
+        for (int taps = 1; taps <= 9; taps += 4) {
+            // Mixed signs, so sums fall outside 0..255 D and get clamped
+            int scale = divisors[d] < 8000 ? divisors[d] : 8000;
+            for (int t = 0; t < taps; t++) {
+                weights[t] = (int16_t)((int)(testRandom() % (4 * (unsigned)scale + 1)) - scale);
+            }
+            for (int count = 1; count <= TEST_SIMD_SIZE; count = 2 * count + 3) {
+                bmp_simdSetLevel(BMP_SIMD_SCALAR);
+                bmp_weightedSumBytes(expected, src, weights, taps, count, divisors[d]);
+                bmp_simdSetLevel(level);
+                bmp_weightedSumBytes(actual, src, weights, taps, count, divisors[d]);
+                testCheck(memcmp(expected, actual, (size_t)count) == 0, "bmp_weightedSumBytes", level);
+            }
+        }
+    }
+}
+
+/* Convolution */
+
+#define TEST_WIDTH 293
+#define TEST_HEIGHT 241  // Above BMP_CONV_PARALLEL_MIN pixels, so planes are split across threads
+
+/* Kernel row i reaches row y - n + i of the copy; outside rows and columns are zero */
+static void testConvReference(const t_bmp_kernel *kernel, const uint8_t *copy, uint8_t *out, int width, int height,
+                              int channels, int y0, int y1, int x0, int x1) {
+    size_t rowBytes = (size_t)width * channels;
+    int n = kernel->size / 2;
+    float *scratch = (float *)malloc(bmp_convScratchSize(kernel, width, channels) * sizeof(float));
+    const uint8_t **rows = (const uint8_t **)malloc((size_t)kernel->size * sizeof(*rows));
+    for (int y = y0; y < y1; y++) {
+        for (int i = 0; i < kernel->size; i++) {
+            int src = y - n + i;
+            rows[i] = (src < 0 || src >= height) ? NULL : copy + (size_t)src * rowBytes;
+        }
+        bmp_convRow(kernel, rows, out + (size_t)y * rowBytes, width, channels, x0, x1, scratch);
+    }
+    free(rows);
+    free(scratch);
+}
+
+static int testBorderIndex(int i, int size, int mode) {
+    if (i >= 0 && i < size) return i;
+    switch (mode) {
+        case BMP_BORDER_CLAMP: return i < 0 ? 0 : size - 1;
+        case BMP_BORDER_MIRROR: return i < 0 ? -i : 2 * (size - 1) - i;
+        case BMP_BORDER_WRAP: return ((i % size) + size) % size;
+        default: return -1;
+    }
+}
+
+/* Builds the fully padded image, then filters it row by row */
+static void testBorderReference(const t_bmp_kernel *kernel, const uint8_t *copy, uint8_t *out, int width, int height,
+                                int channels, int mode, uint8_t value) {
+    int n = kernel->size / 2;
+    int paddedWidth = width + 2 * n;
+    size_t paddedBytes = (size_t)paddedWidth * channels;
+    uint8_t *padded = (uint8_t *)malloc((size_t)(height + 2 * n) * paddedBytes);
+    float *scratch = (float *)malloc(bmp_convScratchSize(kernel, width, channels) * sizeof(float));
+    for (int v = -n; v < height + n; v++) {
+        int sy = testBorderIndex(v, height, mode);
+        for (int u = -n; u < width + n; u++) {
+            int sx = testBorderIndex(u, width, mode);
+            for (int c = 0; c < channels; c++) {
+                padded[(size_t)(v + n) * paddedBytes + (size_t)(u + n) * channels + c] =
+                    (sy < 0 || sx < 0) ? value : copy[((size_t)sy * width + sx) * channels + c];
+            }
+        }
+    }
+    const uint8_t **rows = (const uint8_t **)malloc((size_t)kernel->size * sizeof(*rows));
+    for (int y = 0; y < height; y++) {
+        for (int i = 0; i < kernel->size; i++) rows[i] = padded + (size_t)(y + i) * paddedBytes + n * channels;
+        bmp_convRowPadded(kernel, rows, out + (size_t)y * width * channels, width, channels, scratch);
+    }
+    free(rows);
+    free(padded);
+    free(scratch);
+}
+
+/* Random taps summing to about 1, or a binomial kernel whose taps are exact fractions */
+static int testKernel(t_bmp_kernel *kernel, int size, int exact) {
+    float **taps = (float **)malloc(size * sizeof(float *));
+    for (int i = 0; i < size; i++) taps[i] = (float *)malloc(size * sizeof(float));
+    // Binomial coefficients in double: C(40, 20) is not exact in float
+    double *row = (double *)calloc(size, sizeof(double));
+    row[0] = 1.0;
+    for (int i = 1; i < size; i++) {
+        for (int j = i; j > 0; j--) row[j] += row[j - 1];
+    }
+    double total = ldexp(1.0, size - 1);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            if (exact) taps[i][j] = (float)(row[i] * row[j] / (total * total));
+            else taps[i][j] = ((float)(testRandom() % 2001) - 700.0f) / (650.0f * size * size);
+        }
+    }
+    int result = bmp_kernelPrepare(kernel, taps, size);
+    for (int i = 0; i < size; i++) free(taps[i]);
+    free(taps);
+    free(row);
+    return result;
+}
+
+static void testConvThreads(int threads) {
+    static const int sizes[] = {3, 5, 9, 15, 65};
+    size_t maxBytes = (size_t)TEST_WIDTH * TEST_HEIGHT * 3;
+    uint8_t *image = (uint8_t *)malloc(maxBytes);
+    uint8_t *expected = (uint8_t *)malloc(maxBytes);
+    uint8_t *actual = (uint8_t *)malloc(maxBytes);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+
+    for (int channels = 1; channels <= 3; channels += 2) {
+        size_t bytes = (size_t)TEST_WIDTH * TEST_HEIGHT * channels;
+        ptrdiff_t stride = (ptrdiff_t)TEST_WIDTH * channels;
+        for (int s = 0; s < 5; s++) {
+            for (int exact = 0; exact <= 1; exact++) {
+                // Large random kernels are not separable and may go through the FFT, see testFft
+                if (sizes[s] > BMP_CONV_MAX_KERNEL && !exact) continue;
+                t_bmp_kernel kernel;
+                if (testKernel(&kernel, sizes[s], exact) != 0) {
+                    testCheck(0, "bmp_kernelPrepare", threads);
+                    continue;
+                }
+                testFill(image, bytes);
+
+                // Whole plane, then a window that leaves rows and columns untouched
+                int ranges[2][4] = {{0, TEST_HEIGHT, 0, TEST_WIDTH}, {7, TEST_HEIGHT - 11, 13, TEST_WIDTH - 5}};
+                for (int r = 0; r < 2; r++) {
+                    memcpy(expected, image, bytes);
+                    memcpy(actual, image, bytes);
+                    testConvReference(&kernel, image, expected, TEST_WIDTH, TEST_HEIGHT, channels,
+                                      ranges[r][0], ranges[r][1], ranges[r][2], ranges[r][3]);
+                    bmp_convPlane(&kernel, actual, stride, TEST_WIDTH, TEST_HEIGHT, channels,
+                                  ranges[r][0], ranges[r][1], ranges[r][2], ranges[r][3]);
+                    testCheck(memcmp(expected, actual, bytes) == 0, "bmp_convPlane", threads);
+                }
+
+                for (int mode = BMP_BORDER_CONSTANT; mode <= BMP_BORDER_WRAP; mode++) {
+                    memcpy(actual, image, bytes);
+                    testBorderReference(&kernel, image, expected, TEST_WIDTH, TEST_HEIGHT, channels, mode, 77);
+                    bmp_convPlaneBorder(&kernel, actual, stride, TEST_WIDTH, TEST_HEIGHT, channels, mode, 77);
+                    testCheck(memcmp(expected, actual, bytes) == 0, "bmp_convPlaneBorder", threads);
+                }
+                bmp_kernelRelease(&kernel);
+            }
+        }
+    }
+    free(image);
+    free(expected);
+    free(actual);
+}
+
+/* Kernels above BMP_CONV_MAX_KERNEL go through the FFT even where the cost model would filter directly */
+static void testLargeFft(void) {
+    int width = 120, height = 90, size = 81;
+    size_t bytes = (size_t)width * height * 3;
+    uint8_t *image = (uint8_t *)malloc(bytes);
+    uint8_t *expected = (uint8_t *)malloc(bytes);
+    uint8_t *actual = (uint8_t *)malloc(bytes);
+    t_bmp_kernel kernel;
+    if (testKernel(&kernel, size, 0) != 0) {
+        testCheck(0, "bmp_kernelPrepare", size);
+    } else {
+        testCheck(bmp_fftTileSize(&kernel, 4, 4) > 0, "bmp_fftTileSize large kernel", size);
+        for (int channels = 1; channels <= 3; channels += 2) {
+            size_t planeBytes = (size_t)width * height * channels;
+            testFill(image, planeBytes);
+            memcpy(expected, image, planeBytes);
+            memcpy(actual, image, planeBytes);
+            testConvReference(&kernel, image, expected, width, height, channels, 0, height, 0, width);
+            int result = bmp_convPlane(&kernel, actual, (ptrdiff_t)width * channels, width, height, channels,
+                                       0, height, 0, width);
+            testCheck(result == 0 && testMaxDiff(expected, actual, planeBytes) <= 1, "bmp_convPlane FFT", channels);
+        }
+        bmp_kernelRelease(&kernel);
+    }
+    free(image);
+    free(expected);
+    free(actual);
+}
+
+/* Separable sampled Gaussian in double, edge pixels repeated, rounded once at the end */
+static void testGaussianReference(const uint8_t *image, uint8_t *out, int width, int height, int channels,
+                                  double sigma) {
+    int radius = (int)ceil(5 * sigma);
+    double *taps = (double *)malloc((size_t)(2 * radius + 1) * sizeof(double));
+    double *column = (double *)malloc((size_t)width * height * channels * sizeof(double));
+    double total = 0;
+    for (int i = -radius; i <= radius; i++) total += taps[i + radius] = exp(-0.5 * i * i / (sigma * sigma));
+    for (int i = 0; i <= 2 * radius; i++) taps[i] /= total;
+
+    for (int y = 0; y < height; y++) {
+        for (size_t b = 0; b < (size_t)width * channels; b++) {
+            double sum = 0;
+            for (int i = -radius; i <= radius; i++) {
+                int v = y + i < 0 ? 0 : (y + i >= height ? height - 1 : y + i);
+                sum += taps[i + radius] * image[(size_t)v * width * channels + b];
+            }
+            column[(size_t)y * width * channels + b] = sum;
+        }
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                double sum = 0;
+                for (int i = -radius; i <= radius; i++) {
+                    int u = x + i < 0 ? 0 : (x + i >= width ? width - 1 : x + i);
+                    sum += taps[i + radius] * column[((size_t)y * width + u) * channels + c];
+                }
+                out[((size_t)y * width + x) * channels + c] = (uint8_t)(sum < 0 ? 0 : (sum > 255 ? 255 : sum + 0.5));
+            }
+        }
+    }
+    free(taps);
+    free(column);
+}
+
+/* Recursive and small-sigma direct Gaussians stay within two levels of the exact one */
+static void testGaussian(void) {
+    static const float sigmas[] = {1.5f, 2.0f, 5.0f, 20.0f};
+    int width = 97, height = 83;
+    size_t bytes = (size_t)width * height * 3;
+    uint8_t *image = (uint8_t *)malloc(bytes);
+    uint8_t *expected = (uint8_t *)malloc(bytes);
+    uint8_t *actual = (uint8_t *)malloc(bytes);
+    for (int channels = 1; channels <= 3; channels += 2) {
+        size_t planeBytes = (size_t)width * height * channels;
+        testFill(image, planeBytes);
+        for (int s = 0; s < 4; s++) {
+            testGaussianReference(image, expected, width, height, channels, sigmas[s]);
+            memcpy(actual, image, planeBytes);
+            int result = bmp_gaussianPlane(actual, (size_t)width * channels, width, height, channels, sigmas[s]);
+            int diff = testMaxDiff(expected, actual, planeBytes);
+            testCheck(result == 0 && diff <= 2, "bmp_gaussianPlane", (int)sigmas[s]);
+        }
+    }
+    free(image);
+    free(expected);
+    free(actual);
+}
+
+/* Running-sum box filter against the rounded mean of the window clipped to the image */
+static void testBox(void) {
+    static const int radii[] = {1, 2, 7, 40};  // The last one is wider than the image
+    int width = 53, height = 37;
+    uint8_t image[53 * 37 * 3], actual[53 * 37 * 3];
+    for (int channels = 1; channels <= 3; channels += 2) {
+        size_t bytes = (size_t)width * height * channels;
+        testFill(image, bytes);
+        for (int r = 0; r < 4; r++) {
+            int radius = radii[r];
+            memcpy(actual, image, bytes);
+            int result = bmp_boxFilterPlane(actual, (size_t)width * channels, width, height, channels, radius);
+            int same = result == 0;
+            for (int y = 0; same && y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    for (int c = 0; c < channels; c++) {
+                        unsigned int sum = 0, count = 0;
+                        for (int v = y - radius; v <= y + radius; v++) {
+                            for (int u = x - radius; u <= x + radius; u++) {
+                                if (v < 0 || v >= height || u < 0 || u >= width) continue;
+                                sum += image[((size_t)v * width + u) * channels + c];
+                                count++;
+                            }
+                        }
+                        same &= actual[((size_t)y * width + x) * channels + c] == (sum + count / 2) / count;
+                    }
+                }
+            }
+            testCheck(same, "bmp_boxFilterPlane", radius);
+        }
+    }
+
+    // A window above BMP_BOX_MAX_RADIUS inside the image could overflow the sums, it is refused
+    int wide = 2 * BMP_BOX_MAX_RADIUS + 8;
+    uint8_t *row = (uint8_t *)malloc((size_t)wide);
+    testFill(row, (size_t)wide);
+    uint8_t first = row[0];
+    testCheck(bmp_boxFilterPlane(row, (size_t)wide, wide, 1, 1, BMP_BOX_MAX_RADIUS + 1) == -1 && row[0] == first,
+              "bmp_boxFilterPlane radius", BMP_BOX_MAX_RADIUS + 1);
+    free(row);
+}
+
+/* The FFT path may differ from the direct filter by one level near rounding boundaries */
+static void testFft(void) {
+    static const int sizes[] = {17, 25, 41};
+    size_t bytes = (size_t)TEST_WIDTH * TEST_HEIGHT * 3;
+    uint8_t *image = (uint8_t *)malloc(bytes);
+    uint8_t *expected = (uint8_t *)malloc(bytes);
+    uint8_t *actual = (uint8_t *)malloc(bytes);
+
+    for (int channels = 1; channels <= 3; channels += 2) {
+        size_t planeBytes = (size_t)TEST_WIDTH * TEST_HEIGHT * channels;
+        for (int s = 0; s < 3; s++) {
+            t_bmp_kernel kernel;
+            if (testKernel(&kernel, sizes[s], 0) != 0) {
+                testCheck(0, "bmp_kernelPrepare", 0);
+                continue;
+            }
+            testFill(image, planeBytes);
+            memcpy(expected, image, planeBytes);
+            testConvReference(&kernel, image, expected, TEST_WIDTH, TEST_HEIGHT, channels,
+                              3, TEST_HEIGHT - 2, 4, TEST_WIDTH - 9);
+            // Every tile size the kernel fits, not only the one the cost model picks
+            for (int tile = 32; tile <= BMP_FFT_MAX_SIZE; tile *= 2) {
+                if (tile - sizes[s] + 1 < 1) continue;
+                memcpy(actual, image, planeBytes);
+                int result = bmp_fftConvPlane(&kernel, actual, (ptrdiff_t)TEST_WIDTH * channels, TEST_WIDTH,
+                                              TEST_HEIGHT, channels, 3, TEST_HEIGHT - 2, 4, TEST_WIDTH - 9, tile);
+                testCheck(result == 0 && testMaxDiff(expected, actual, planeBytes) <= 1, "bmp_fftConvPlane", tile);
+            }
+            bmp_kernelRelease(&kernel);
+        }
+    }
+    free(image);
+    free(expected);
+    free(actual);
+}
+
+int main(void) {
+    int detected = bmp_simdLevel();
+    for (int level = BMP_SIMD_SSE2; level <= detected; level++) {
+        testWeightedSumLevel(level);
+    }
+    bmp_simdSetLevel(detected);
+
+    testConvThreads(1);
+    testConvThreads(4);
+    testFft();
+    testLargeFft();
+    testBox();
+    testGaussian();
+
+    return testReport("test_conv");
+}
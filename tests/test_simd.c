@@ -0,0 +1,114 @@
+/**
+ * Regression tests for the SIMD pixel kernels
+ *
+ * Every SIMD level the CPU supports is compared byte for byte against the
+ * scalar kernels, on sizes that leave a tail after each vector loop.
+ */
+
+#include "bmp_simd.h"
+#include "test_util.h"
+
+#define TEST_SIMD_SIZE 4099  // Odd, so every vector loop leaves a tail
+
+static void testSimdLevel(int level) {
+    static uint8_t input[3 * TEST_SIMD_SIZE], expected[3 * TEST_SIMD_SIZE], actual[3 * TEST_SIMD_SIZE];
+    static const int sizes[] = {0, 1, 15, 17, 31, 33, 63, 65, 130, TEST_SIMD_SIZE};
+    int sizeCount = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    testFill(input, sizeof(input));
+
+    for (int s = 0; s < sizeCount; s++) {
+        int count = sizes[s];
+        size_t bytes = 3 * (size_t)count;
+
+        memcpy(expected, input, bytes);
+        memcpy(actual, input, bytes);
+        bmp_simdSetLevel(BMP_SIMD_SCALAR);
+        bmp_negativeBytes(expected, bytes);
+        bmp_simdSetLevel(level);
+        bmp_negativeBytes(actual, bytes);
+        testCheck(memcmp(expected, actual, bytes) == 0, "bmp_negativeBytes", level);
+
+        static const int values[] = {-300, -77, 0, 5, 200};
+        for (int v = 0; v < 5; v++) {
+            memcpy(expected, input, bytes);
+            memcpy(actual, input, bytes);
+            bmp_simdSetLevel(BMP_SIMD_SCALAR);
+            bmp_brightnessBytes(expected, bytes, values[v]);
+            bmp_simdSetLevel(level);
+            bmp_brightnessBytes(actual, bytes, values[v]);
+            testCheck(memcmp(expected, actual, bytes) == 0, "bmp_brightnessBytes", level);
+        }
+
+        static const int thresholds[] = {0, 127, 128, 254, 255};
+        for (int t = 0; t < 5; t++) {
+            memcpy(expected, input, bytes);
+            memcpy(actual, input, bytes);
+            bmp_simdSetLevel(BMP_SIMD_SCALAR);
+            bmp_thresholdBytes(expected, bytes, thresholds[t]);
+            bmp_simdSetLevel(level);
+            bmp_thresholdBytes(actual, bytes, thresholds[t]);
+            testCheck(memcmp(expected, actual, bytes) == 0, "bmp_thresholdBytes", level);
+        }
+
+        bmp_simdSetLevel(BMP_SIMD_SCALAR);
+        bmp_swapRedBlue(expected, input, count);
+        bmp_simdSetLevel(level);
+        bmp_swapRedBlue(actual, input, count);
+        testCheck(memcmp(expected, actual, bytes) == 0, "bmp_swapRedBlue", level);
+
+        memset(expected, 0, (size_t)count);
+        memset(actual, 0, (size_t)count);
+        bmp_simdSetLevel(BMP_SIMD_SCALAR);
+        bmp_lumaBytes(expected, input, count, 9798, 19235, 3735);
+        bmp_simdSetLevel(level);
+        bmp_lumaBytes(actual, input, count, 9798, 19235, 3735);
+        testCheck(memcmp(expected, actual, (size_t)count) == 0, "bmp_lumaBytes", level);
+
+        unsigned int histExpected[256] = {0}, histActual[256] = {0};
+        memcpy(expected, input, bytes);
+        memcpy(actual, input, bytes);
+        bmp_simdSetLevel(BMP_SIMD_SCALAR);
+        bmp_toYCbCr(expected, count, histExpected);
+        bmp_simdSetLevel(level);
+        bmp_toYCbCr(actual, count, histActual);
+        testCheck(memcmp(expected, actual, bytes) == 0, "bmp_toYCbCr", level);
+        testCheck(memcmp(histExpected, histActual, sizeof(histExpected)) == 0, "bmp_toYCbCr histogram", level);
+
+        uint8_t lut[256];
+        testFill(lut, sizeof(lut));
+        memcpy(expected, input, bytes);
+        memcpy(actual, input, bytes);
+        bmp_simdSetLevel(BMP_SIMD_SCALAR);
+        bmp_fromYCbCr(expected, count, lut);
+        bmp_simdSetLevel(level);
+        bmp_fromYCbCr(actual, count, lut);
+        testCheck(memcmp(expected, actual, bytes) == 0, "bmp_fromYCbCr", level);
+    }
+}
+
+/* Every thread sees the same level, however many ask for it first */
+static void testDetect(void) {
+    int mismatches = 0;
+    bmp_simdSetLevel(BMP_SIMD_AVX512);
+    int level = bmp_simdLevel();
+    #pragma omp parallel for reduction(+ : mismatches)
+    for (int i = 0; i < 64; i++) {
+        mismatches += bmp_simdLevel() != level;
+    }
+    testCheck(mismatches == 0, "bmp_simdLevel threads", mismatches);
+    testCheck(level >= BMP_SIMD_SCALAR && level <= BMP_SIMD_AVX512, "bmp_simdLevel range", level);
+
+    bmp_simdSetLevel(BMP_SIMD_SCALAR);
+    testCheck(bmp_simdLevel() == BMP_SIMD_SCALAR, "bmp_simdSetLevel cap", level);
+    bmp_simdSetLevel(level);
+}
+
+int main(void) {
+    testDetect();
+    int detected = bmp_simdLevel();
+    for (int level = BMP_SIMD_SSE2; level <= detected; level++) {
+        testSimdLevel(level);
+    }
+    bmp_simdSetLevel(detected);
+    return testReport("test_simd");
+}
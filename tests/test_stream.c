@@ -0,0 +1,130 @@
+/**
+ * Regression tests for strip streaming
+ *
+ * A pipeline run through bmp_stream must give the same file as the matching
+ * bmp8_* / bmp24_* calls on the fully loaded image, whatever the strip height.
+ */
+
+#include "bmp_stream.h"
+#include "bmp8.h"
+#include "bmp24.h"
+#include "test_util.h"
+
+#define TEST_FILE "test_stream.bmp"
+#define TEST_OUT "test_stream_out.bmp"
+#define TEST_KERNEL 5
+
+/* Kernel with distinct taps, so a flipped row or column order shows */
+static float **testKernelRows(void) {
+    float **kernel = (float **)malloc(TEST_KERNEL * sizeof(float *));
+    for (int i = 0; i < TEST_KERNEL; i++) {
+        kernel[i] = (float *)malloc(TEST_KERNEL * sizeof(float));
+        for (int j = 0; j < TEST_KERNEL; j++) kernel[i][j] = (float)(i * TEST_KERNEL + j + 1) / 325.0f;
+    }
+    return kernel;
+}
+
+static void testFreeKernel(float **kernel) {
+    for (int i = 0; i < TEST_KERNEL; i++) free(kernel[i]);
+    free(kernel);
+}
+
+/* Brightness, filter, negative: stream against the in-memory calls */
+static int testPipeline(unsigned int stripHeight, float **kernel) {
+    t_bmp_stream *stream = bmp_streamOpen(TEST_FILE, TEST_OUT, stripHeight);
+    if (!stream) return -1;
+    int result = bmp_streamBrightness(stream, 30);
+    if (result == 0) result = bmp_streamFilter(stream, kernel, TEST_KERNEL);
+    if (result == 0) result = bmp_streamNegative(stream);
+    if (result == 0) result = bmp_streamRun(stream);
+    bmp_streamClose(stream);
+    return result;
+}
+
+static void testStream8(void) {
+    static const unsigned int strips[] = {1, 4, 0};
+    int width = 41, height = 29;
+    uint8_t gray[41 * 29];
+    testFill(gray, sizeof(gray));
+    testWriteBmp8(TEST_FILE, width, height, 0, gray);
+    float **kernel = testKernelRows();
+
+    t_bmp8 *expected = bmp8_loadImage(TEST_FILE);
+    bmp8_brightness(expected, 30);
+    bmp8_applyFilter(expected, kernel, TEST_KERNEL);
+    bmp8_negative(expected);
+
+    for (int s = 0; s < 3; s++) {
+        testCheck(testPipeline(strips[s], kernel) == 0, "bmp_streamRun 8-bit", (int)strips[s]);
+        t_bmp8 *actual = bmp8_loadImage(TEST_OUT);
+        testCheck(actual && expected && actual->dataSize == expected->dataSize &&
+                  memcmp(actual->data, expected->data, expected->dataSize) == 0, "bmp_stream 8-bit pixels",
+                  (int)strips[s]);
+        bmp8_free(actual);
+    }
+    bmp8_free(expected);
+    testFreeKernel(kernel);
+}
+
+static void testStream24(void) {
+    static const unsigned int strips[] = {1, 4, 0};
+    int width = 23, height = 31;
+    uint8_t rgb[23 * 31 * 3];
+    testFill(rgb, sizeof(rgb));
+    testWriteBmp24(TEST_FILE, width, height, 0, rgb);
+    float **kernel = testKernelRows();
+
+    t_bmp24 *expected = bmp24_loadImage(TEST_FILE);
+    bmp24_brightness(expected, 30);
+    bmp24_applyFilter(expected, kernel, TEST_KERNEL);
+    bmp24_negative(expected);
+
+    for (int s = 0; s < 3; s++) {
+        testCheck(testPipeline(strips[s], kernel) == 0, "bmp_streamRun 24-bit", (int)strips[s]);
+        t_bmp24 *actual = bmp24_loadImage(TEST_OUT);
+        int same = actual && expected && actual->width == width && actual->height == height;
+        for (int y = 0; same && y < height; y++) {
+            same = memcmp(bmp24_row(actual, y), bmp24_row(expected, y), (size_t)width * 3) == 0;
+        }
+        testCheck(same, "bmp_stream 24-bit pixels", (int)strips[s]);
+        bmp24_free(actual);
+    }
+    bmp24_free(expected);
+    testFreeKernel(kernel);
+}
+
+/* Top-down files and sizes that wrap are refused before anything is allocated */
+static void testBadHeaders(void) {
+    static const int32_t sizes[][3] = {
+        {8, -8, 8}, {8, -8, 24}, {0, 8, 8}, {8, 0, 24}, {0x40000000, 8, 8}, {0x60000000, 1, 24}, {70000, 70000, 24}
+    };
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        testWriteHeaderOnly(TEST_FILE, sizes[i][0], sizes[i][1], sizes[i][2], 64);
+        t_bmp_stream *stream = bmp_streamOpen(TEST_FILE, TEST_OUT, 0);
+        testCheck(stream == NULL, "bmp_streamOpen bad size", i);
+        bmp_streamClose(stream);
+    }
+}
+
+/* A destination that cannot take the data makes the run fail */
+static void testWriteError(void) {
+#ifdef __linux__
+    uint8_t gray[16 * 4];
+    testFill(gray, sizeof(gray));
+    testWriteBmp8(TEST_FILE, 16, 4, 0, gray);
+    t_bmp_stream *stream = bmp_streamOpen(TEST_FILE, "/dev/full", 0);
+    if (!stream) return;
+    testCheck(bmp_streamNegative(stream) == 0 && bmp_streamRun(stream) != 0, "bmp_streamRun full device", 0);
+    bmp_streamClose(stream);
+#endif
+}
+
+int main(void) {
+    testStream8();
+    testStream24();
+    testBadHeaders();
+    testWriteError();
+    remove(TEST_FILE);
+    remove(TEST_OUT);
+    return testReport("test_stream");
+}
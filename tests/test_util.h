@@ -0,0 +1,142 @@
+/**
+ * test_util.h
+ * Helpers shared by the regression tests
+ *
+ * Each test program includes this header once: it counts failed checks,
+ * produces repeatable pseudo-random bytes and writes small BMP files to the
+ * working directory (the build directory under ctest).
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+static int failures = 0;
+static uint32_t seed = 12345;
+
+static inline uint32_t testRandom(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static inline void testFill(uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) data[i] = (uint8_t)testRandom();
+}
+
+/* Largest absolute difference between two buffers */
+static inline int testMaxDiff(const uint8_t *a, const uint8_t *b, size_t size) {
+    int worst = 0;
+    for (size_t i = 0; i < size; i++) {
+        int d = abs(a[i] - b[i]);
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
+
+/* Counts a failure; detail is the SIMD level, thread count, size... under test */
+static inline void testCheck(int ok, const char *what, int detail) {
+    if (!ok) {
+        printf("FAIL: %s (%d)\n", what, detail);
+        failures++;
+    }
+}
+
+/* Exit status of a test program */
+static inline int testReport(const char *name) {
+    if (failures) {
+        printf("%s: %d check(s) failed\n", name, failures);
+        return 1;
+    }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+/* Little-endian header fields */
+static inline void testPut16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void testPut32(uint8_t *p, uint32_t v) {
+    testPut16(p, v & 0xFFFF);
+    testPut16(p + 2, v >> 16);
+}
+
+/*
+ * Writes the 54-byte headers of an uncompressed BMP; height < 0 marks a
+ * top-down file. Sizes are written as given, so broken headers can be built.
+ */
+static inline void testWriteHeader(FILE *file, int32_t width, int32_t height, int bits, uint32_t offset, uint32_t dataSize) {
+    uint8_t header[54] = {'B', 'M'};
+    testPut32(header + 2, offset + dataSize);
+    testPut32(header + 10, offset);
+    testPut32(header + 14, 40);
+    testPut32(header + 18, (uint32_t)width);
+    testPut32(header + 22, (uint32_t)height);
+    testPut16(header + 26, 1);
+    testPut16(header + 28, (uint32_t)bits);
+    testPut32(header + 34, dataSize);
+    testPut32(header + 46, bits == 8 ? 256 : 0);
+    fwrite(header, 1, sizeof(header), file);
+}
+
+/*
+ * Writes a 24-bit BMP from top-down RGB rows of width * 3 bytes, bottom-up
+ * unless topDown is set; 0 on success
+ */
+static inline int testWriteBmp24(const char *path, int width, int height, int topDown, const uint8_t *rgb) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return -1;
+    size_t rowSize = ((size_t)width * 3 + 3) & ~(size_t)3;
+    testWriteHeader(file, width, topDown ? -height : height, 24, 54, (uint32_t)(rowSize * height));
+    uint8_t *row = (uint8_t *)calloc(rowSize, 1);
+    for (int r = 0; r < height; r++) {
+        const uint8_t *src = rgb + (size_t)(topDown ? r : height - 1 - r) * width * 3;
+        for (int x = 0; x < width; x++) {
+            row[3 * x] = src[3 * x + 2];
+            row[3 * x + 1] = src[3 * x + 1];
+            row[3 * x + 2] = src[3 * x];
+        }
+        fwrite(row, 1, rowSize, file);
+    }
+    free(row);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+/*
+ * Writes an 8-bit BMP with a grey palette from top-down rows of width bytes,
+ * bottom-up unless topDown is set; 0 on success
+ */
+static inline int testWriteBmp8(const char *path, int width, int height, int topDown, const uint8_t *gray) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return -1;
+    size_t rowSize = ((size_t)width + 3) & ~(size_t)3;
+    testWriteHeader(file, width, topDown ? -height : height, 8, 54 + 1024, (uint32_t)(rowSize * height));
+    for (int i = 0; i < 256; i++) {
+        uint8_t entry[4] = {(uint8_t)i, (uint8_t)i, (uint8_t)i, 0};
+        fwrite(entry, 1, 4, file);
+    }
+    uint8_t *row = (uint8_t *)calloc(rowSize, 1);
+    for (int r = 0; r < height; r++) {
+        memcpy(row, gray + (size_t)(topDown ? r : height - 1 - r) * width, (size_t)width);
+        fwrite(row, 1, rowSize, file);
+    }
+    free(row);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+/* Writes headers only, followed by size zero bytes; 0 on success */
+static inline int testWriteHeaderOnly(const char *path, int32_t width, int32_t height, int bits, size_t size) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return -1;
+    uint32_t offset = bits == 8 ? 54 + 1024 : 54;
+    testWriteHeader(file, width, height, bits, offset, (uint32_t)size);
+    for (size_t i = 54; i < offset + size; i++) fputc(0, file);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+#endif // TEST_UTIL_H